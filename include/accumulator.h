@@ -95,6 +95,24 @@ public:
         _mean = Real::invalid_value;
     }
 
+    //  running_value
+    //  mean
+    //      Expose the state of the accumulator for checkpointing.
+    //
+    inline const RollingDataSet& running_value() const { return _running_value; }
+    inline const Real& mean() const { return _mean; }
+
+    //  restore
+    //      Put the accumulator back into a checkpointed state.
+    //      running_value - the last (at most N) values, oldest first.
+    //      mean          - their mean.
+    //
+    inline void restore(const RollingDataSet& running_value, const Real& mean)
+    {
+        _running_value = running_value;
+        _mean = mean;
+    }
+
 protected:
     //  _running_values
     //      This is the set of N elements.
@@ -113,6 +131,54 @@ protected:
 };
 
 
+//  Stream I/O operators.
+//  operator<<
+//      Save the state of an accumulator: the number of values,
+//      the values and the mean.
+//      out - output stream.
+//      ma  - MovingAverageN to stream.
+//      returns - stream for continued use.
+//
+template<class Real, int N>
+ostream& operator<< (ostream& out, const MovingAverageN<Real, N>& ma)
+{
+    IntType count(ma.running_value().size());
+    out << count;
+    BOOST_FOREACH(const Real& r, ma.running_value())
+        out << r;
+    out << ma.mean();
+
+    if (!constants::save_as_binary) out << endl;
+    return out;
+}
+
+//  operator>>
+//      in - input stream.
+//      ma - MovingAverageN to restore.
+//      returns - stream for continued use.
+//
+template<class Real, int N>
+istream& operator>> (istream& in, MovingAverageN<Real, N>& ma)
+{
+    IntType count;
+    in >> count;
+
+    typename MovingAverageN<Real, N>::RollingDataSet running_value;
+    for(int i = 0; (i < count) && (i < N) && in.good(); i++)
+    {
+        Real r;
+        in >> r;
+        running_value.push_back(r);
+    }
+
+    Real mean;
+    in >> mean;
+
+    ma.restore(running_value, mean);
+    return in;
+}
+
+
 //  MovingAverages
 //      Calculate both 10- and 50-day moving averages for
 //      a sequence of data.
@@ -144,6 +210,15 @@ public:
         _fifty.reset();
     }
 
+    //  ten
+    //  fifty
+    //      Expose the accumulators for checkpointing.
+    //
+    inline MovingAverageN<Real, 10>& ten() { return _ten; }
+    inline MovingAverageN<Real, 50>& fifty() { return _fifty; }
+    inline const MovingAverageN<Real, 10>& ten() const { return _ten; }
+    inline const MovingAverageN<Real, 50>& fifty() const { return _fifty; }
+
 protected:
     //  ten_day_collector
     //      Tool to compute a 10-day moving average.
@@ -157,6 +232,31 @@ protected:
     
 };
 
+//  Stream I/O operators.
+//  operator<<
+//      out - output stream.
+//      ma  - MovingAverages to stream.
+//      returns - stream for continued use.
+//
+template<class Real>
+ostream& operator<< (ostream& out, const MovingAverages<Real>& ma)
+{
+    out << ma.ten() << ma.fifty();
+    return out;
+}
+
+//  operator>>
+//      in - input stream.
+//      ma - MovingAverages to restore.
+//      returns - stream for continued use.
+//
+template<class Real>
+istream& operator>> (istream& in, MovingAverages<Real>& ma)
+{
+    in >> ma.ten() >> ma.fifty();
+    return in;
+}
+
 typedef MovingAverages<FloatType>  FloatMovingAverages;
 typedef MovingAverages<DoubleType> DoubleMovingAverages;
 
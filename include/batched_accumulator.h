@@ -0,0 +1,467 @@
+#ifndef BATCHED_ACCUMULATOR_H
+#define BATCHED_ACCUMULATOR_H
+
+#include "numerictypes.h"
+#include "source_data.h"
+#include "accumulator.h"
+#include <deque>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+using namespace std;
+
+//  FloatLanes
+//      Thin wrapper around the widest float register available at
+//      compile time. Build with -mavx2 or -mavx512f (or -march=native)
+//      to get the vector versions; otherwise a plain 8-wide loop.
+//      width - number of floats (symbols) updated in one step.
+//
+#if defined(__AVX512F__)
+
+struct FloatLanes
+{
+    static const int width = 16;
+    typedef __m512    Vector;
+    typedef __mmask16 Mask;
+
+    static inline Vector load(const float * p)      { return _mm512_load_ps(p); }
+    static inline Vector loadu(const float * p)     { return _mm512_loadu_ps(p); }
+    static inline void store(float * p, Vector v)   { _mm512_store_ps(p, v); }
+    static inline Vector set1(float f)              { return _mm512_set1_ps(f); }
+    static inline Vector add(Vector a, Vector b)    { return _mm512_add_ps(a, b); }
+    static inline Vector sub(Vector a, Vector b)    { return _mm512_sub_ps(a, b); }
+    static inline Vector mul(Vector a, Vector b)    { return _mm512_mul_ps(a, b); }
+    static inline Vector min(Vector a, Vector b)    { return _mm512_min_ps(a, b); }
+    static inline Vector sqrt(Vector a)             { return _mm512_sqrt_ps(a); }
+
+    //  is_valid
+    //      Lanes that are not NaN.
+    //
+    static inline Mask is_valid(Vector a)
+    {
+        return _mm512_cmp_ps_mask(a, a, _CMP_ORD_Q);
+    }
+    static inline Mask equal(Vector a, Vector b)
+    {
+        return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+    }
+    static inline Mask both(Mask a, Mask b)         { return a & b; }
+
+    //  from_bits
+    //      Lane i is set where bit i is.
+    //
+    static inline Mask from_bits(uint32_t bits)     { return Mask(bits); }
+
+    //  select
+    //      m ? a : b, lane by lane.
+    //
+    static inline Vector select(Mask m, Vector a, Vector b)
+    {
+        return _mm512_mask_blend_ps(m, b, a);
+    }
+};
+
+#elif defined(__AVX2__)
+
+struct FloatLanes
+{
+    static const int width = 8;
+    typedef __m256 Vector;
+    typedef __m256 Mask;
+
+    static inline Vector load(const float * p)      { return _mm256_load_ps(p); }
+    static inline Vector loadu(const float * p)     { return _mm256_loadu_ps(p); }
+    static inline void store(float * p, Vector v)   { _mm256_store_ps(p, v); }
+    static inline Vector set1(float f)              { return _mm256_set1_ps(f); }
+    static inline Vector add(Vector a, Vector b)    { return _mm256_add_ps(a, b); }
+    static inline Vector sub(Vector a, Vector b)    { return _mm256_sub_ps(a, b); }
+    static inline Vector mul(Vector a, Vector b)    { return _mm256_mul_ps(a, b); }
+    static inline Vector min(Vector a, Vector b)    { return _mm256_min_ps(a, b); }
+    static inline Vector sqrt(Vector a)             { return _mm256_sqrt_ps(a); }
+
+    static inline Mask is_valid(Vector a)
+    {
+        return _mm256_cmp_ps(a, a, _CMP_ORD_Q);
+    }
+    static inline Mask equal(Vector a, Vector b)
+    {
+        return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+    }
+    static inline Mask both(Mask a, Mask b)         { return _mm256_and_ps(a, b); }
+
+    static inline Mask from_bits(uint32_t bits)
+    {
+        const __m256i lane = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+        __m256i set = _mm256_and_si256(_mm256_set1_epi32(int(bits)), lane);
+        return _mm256_castsi256_ps(_mm256_cmpeq_epi32(set, lane));
+    }
+
+    static inline Vector select(Mask m, Vector a, Vector b)
+    {
+        return _mm256_blendv_ps(b, a, m);
+    }
+};
+
+#else
+
+struct FloatLanes
+{
+    static const int width = 8;
+    struct Vector { float f[width]; };
+    struct Mask   { bool  b[width]; };
+
+    static inline Vector load(const float * p)
+    {
+        Vector v;
+        for (int i = 0; i < width; ++i) v.f[i] = p[i];
+        return v;
+    }
+    static inline Vector loadu(const float * p)     { return load(p); }
+    static inline void store(float * p, Vector v)
+    {
+        for (int i = 0; i < width; ++i) p[i] = v.f[i];
+    }
+    static inline Vector set1(float f)
+    {
+        Vector v;
+        for (int i = 0; i < width; ++i) v.f[i] = f;
+        return v;
+    }
+    static inline Vector add(Vector a, Vector b)
+    {
+        for (int i = 0; i < width; ++i) a.f[i] += b.f[i];
+        return a;
+    }
+    static inline Vector sub(Vector a, Vector b)
+    {
+        for (int i = 0; i < width; ++i) a.f[i] -= b.f[i];
+        return a;
+    }
+    static inline Vector mul(Vector a, Vector b)
+    {
+        for (int i = 0; i < width; ++i) a.f[i] *= b.f[i];
+        return a;
+    }
+    static inline Vector min(Vector a, Vector b)
+    {
+        for (int i = 0; i < width; ++i) a.f[i] = (a.f[i] < b.f[i]) ? a.f[i] : b.f[i];
+        return a;
+    }
+    static inline Vector sqrt(Vector a)
+    {
+        for (int i = 0; i < width; ++i) a.f[i] = ::sqrtf(a.f[i]);
+        return a;
+    }
+
+    static inline Mask is_valid(Vector a)
+    {
+        Mask m;
+        for (int i = 0; i < width; ++i) m.b[i] = !isnan(a.f[i]);
+        return m;
+    }
+    static inline Mask equal(Vector a, Vector b)
+    {
+        Mask m;
+        for (int i = 0; i < width; ++i) m.b[i] = (a.f[i] == b.f[i]);
+        return m;
+    }
+    static inline Mask both(Mask a, Mask b)
+    {
+        for (int i = 0; i < width; ++i) a.b[i] = a.b[i] && b.b[i];
+        return a;
+    }
+    static inline Mask from_bits(uint32_t bits)
+    {
+        Mask m;
+        for (int i = 0; i < width; ++i) m.b[i] = (0 != (bits & (1u << i)));
+        return m;
+    }
+
+    static inline Vector select(Mask m, Vector a, Vector b)
+    {
+        for (int i = 0; i < width; ++i) if (!m.b[i]) a.f[i] = b.f[i];
+        return a;
+    }
+};
+
+#endif
+
+
+//  BatchedMovingAverageN
+//      FloatLanes::width MovingAverageN<FloatType, N>'s side by side.
+//      The windows are stored interleaved - _window[i][lane] - as a
+//      shift register, oldest value first, so one step updates every
+//      lane with the same instructions. Lanes given an invalid value
+//      are left untouched, exactly like the scalar version.
+//      Produces the same residuals, means and root mean squares as
+//      MovingAverageN, operation for operation.
+//
+template<int N>
+class BatchedMovingAverageN
+{
+public:
+    typedef FloatLanes               Lanes;
+    typedef NDayType<FloatType, N>   NDay;
+
+    //  Constructor
+    //
+    inline BatchedMovingAverageN() { reset(); }
+
+    //  update
+    //      Add a new value into each lane.
+    //      new_value - Lanes::width values, NaN for "no update."
+    //      nday      - Lanes::width destinations, written only when the
+    //                  lane was updated and holds N samples.
+    //                  Null entries are skipped.
+    //
+    inline void update(const float * new_value, NDay * const * nday)
+    {
+        typedef typename Lanes::Vector Vector;
+        typedef typename Lanes::Mask   Mask;
+
+        const Vector portion = Lanes::set1(_portion);
+        const Vector full    = Lanes::set1(float(N));
+
+        Vector x     = Lanes::load(new_value);
+        Mask   valid = Lanes::is_valid(x);
+        Vector count = Lanes::load(_count);
+        Vector mean  = Lanes::load(_mean);
+
+        //  Update the mean with the new value's portion
+        //  (an empty accumulator starts from the portion itself).
+        //
+        Vector xp       = Lanes::mul(x, portion);
+        Mask   empty    = Lanes::equal(count, Lanes::set1(0.0f));
+        Vector new_mean = Lanes::select(empty, xp, Lanes::add(mean, xp));
+
+        //  Pull the oldest value's portion from the mean of full lanes.
+        //
+        Vector oldest = Lanes::load(_window[0]);
+        new_mean = Lanes::select(Lanes::equal(count, full),
+                                 Lanes::sub(new_mean,
+                                            Lanes::mul(oldest, portion)),
+                                 new_mean);
+
+        mean  = Lanes::select(valid, new_mean, mean);
+        count = Lanes::select(valid,
+                              Lanes::min(Lanes::add(count, Lanes::set1(1.0f)),
+                                         full),
+                              count);
+        Lanes::store(_mean, mean);
+        Lanes::store(_count, count);
+
+        //  Shift the valid lanes along, computing the residuals and the
+        //  sum of their squares on the way through.
+        //
+        Vector sum_of_squares = Lanes::set1(0.0f);
+        for (int i = 0; i < N; ++i)
+        {
+            Vector current = (i + 1 < N) ? Lanes::load(_window[i + 1]) : x;
+            Vector shifted = Lanes::select(valid, current,
+                                           Lanes::load(_window[i]));
+            Lanes::store(_window[i], shifted);
+
+            Vector r = Lanes::sub(shifted, mean);
+            Lanes::store(_residual[i], r);
+
+            Vector r2 = Lanes::mul(r, r);
+            sum_of_squares = (0 == i) ? r2 : Lanes::add(sum_of_squares, r2);
+        }
+        Lanes::store(_root_mean_square, Lanes::sqrt(sum_of_squares));
+
+        //  Scatter the lanes that were updated and are full.
+        //
+        float updated[Lanes::width] __attribute__((aligned(64)));
+        Lanes::store(updated, Lanes::select(
+                                  Lanes::both(valid, Lanes::equal(count, full)),
+                                  Lanes::set1(1.0f), Lanes::set1(0.0f)));
+
+        for (int lane = 0; lane < Lanes::width; ++lane)
+        {
+            if ((0.0f == updated[lane]) || (0 == nday[lane])) continue;
+
+            NDay& nd = *nday[lane];
+            nd.mean = _mean[lane];
+            for (int i = 0; i < N; ++i)
+                nd.residual[i] = _residual[i][lane];
+            nd.root_mean_square = _root_mean_square[lane];
+        }
+    }
+
+    //  store_lane
+    //      Copy one lane's state into a scalar accumulator.
+    //      lane - Lane to copy.
+    //      ma   - Destination.
+    //
+    inline void store_lane(int lane, MovingAverageN<FloatType, N>& ma) const
+    {
+        typename MovingAverageN<FloatType, N>::RollingDataSet running_value;
+        for (int i = N - int(_count[lane]); i < N; ++i)
+            running_value.push_back(_window[i][lane]);
+
+        ma.restore(running_value,
+                   running_value.empty() ? FloatType::invalid_value
+                                         : _mean[lane]);
+    }
+
+    //  load_lane
+    //      Copy a scalar accumulator's state into one lane.
+    //      lane - Lane to fill.
+    //      ma   - Source.
+    //
+    inline void load_lane(int lane, const MovingAverageN<FloatType, N>& ma)
+    {
+        int count = ma.running_value().size();
+        for (int i = 0; i < N; ++i)
+        {
+            _window[i][lane] = (i < N - count) ? 0.0f
+                : float(ma.running_value()[i - (N - count)]);
+        }
+        _count[lane] = float(count);
+        _mean[lane]  = (0 == count) ? 0.0f : float(ma.mean());
+    }
+
+    //  reset
+    //      Resets every lane to completely uninitialized.
+    //
+    inline void reset()
+    {
+        _portion = 1.0f / float(N);
+        for (int lane = 0; lane < Lanes::width; ++lane)
+        {
+            _mean[lane] = 0.0f;
+            _count[lane] = 0.0f;
+            for (int i = 0; i < N; ++i)
+                _window[i][lane] = 0.0f;
+        }
+    }
+
+protected:
+    //  _window
+    //      The last N values of each lane, oldest first.
+    //
+    float _window[N][FloatLanes::width] __attribute__((aligned(64)));
+
+    //  _residual
+    //  _root_mean_square
+    //      Scratch for the scatter back into NDayType's.
+    //
+    float _residual[N][FloatLanes::width] __attribute__((aligned(64)));
+    float _root_mean_square[FloatLanes::width] __attribute__((aligned(64)));
+
+    //  _mean
+    //  _count
+    //      Mean and number of samples (up to N) in each lane.
+    //
+    float _mean[FloatLanes::width] __attribute__((aligned(64)));
+    float _count[FloatLanes::width] __attribute__((aligned(64)));
+
+    //  _portion
+    //      1/N - used to minimize division.
+    //
+    float _portion;
+};
+
+
+//  BatchedMovingAverages
+//      Calculate both 10- and 50-day moving averages for
+//      FloatLanes::width sequences of data at once.
+//      Batched counterpart of MovingAverages<FloatType>.
+//
+class BatchedMovingAverages
+{
+public:
+    typedef FloatLanes Lanes;
+
+    //  update
+    //      Add a new value into each lane's rolling accumulators.
+    //      new_value - Lanes::width values, NaN for "no update."
+    //      sdata     - Lanes::width destinations, null for unused lanes.
+    //
+    inline void update(const float * new_value, FloatStatisticalData * const * sdata)
+    {
+        NDayType<FloatType, 10> * ten[Lanes::width];
+        NDayType<FloatType, 50> * fifty[Lanes::width];
+
+        for (int lane = 0; lane < Lanes::width; ++lane)
+        {
+            if (0 != sdata[lane])
+            {
+                sdata[lane]->value = new_value[lane];
+                ten[lane]   = &sdata[lane]->ten_day;
+                fifty[lane] = &sdata[lane]->fifty_day;
+            }
+            else
+            {
+                ten[lane]   = 0;
+                fifty[lane] = 0;
+            }
+        }
+
+        _ten.update(new_value, ten);
+        _fifty.update(new_value, fifty);
+    }
+
+    //  store_lane
+    //  load_lane
+    //      Copy one lane's state to or from a scalar accumulator.
+    //
+    inline void store_lane(int lane, FloatMovingAverages& ma) const
+    {
+        _ten.store_lane(lane, ma.ten());
+        _fifty.store_lane(lane, ma.fifty());
+    }
+
+    inline void load_lane(int lane, const FloatMovingAverages& ma)
+    {
+        _ten.load_lane(lane, ma.ten());
+        _fifty.load_lane(lane, ma.fifty());
+    }
+
+    //  reset
+    //      Resets to completely uninitialized.
+    //
+    inline void reset()
+    {
+        _ten.reset();
+        _fifty.reset();
+    }
+
+protected:
+    BatchedMovingAverageN<10> _ten;
+    BatchedMovingAverageN<50> _fifty;
+};
+
+typedef ExtendedContainer< BatchedMovingAverages,
+                           deque< BatchedMovingAverages > >
+                         BatchedAccumulatorDeque;
+
+
+//  same_nday
+//  same_statistics
+//      Compare two sets of statistical data bit for bit.
+//      Used to validate the batched accumulators against
+//      the scalar ones. NaN's compare equal to each other.
+//
+template<int N>
+inline bool same_nday(const NDayType<FloatType, N>& a,
+                      const NDayType<FloatType, N>& b)
+{
+    if (0 != memcmp(&a.mean, &b.mean, sizeof(FloatType)))  return false;
+    if (0 != memcmp(&a.root_mean_square, &b.root_mean_square,
+                    sizeof(FloatType)))                     return false;
+    return (0 == memcmp(&a.residual[0], &b.residual[0], N * sizeof(FloatType)));
+}
+
+inline bool same_statistics(const FloatStatisticalData& a,
+                            const FloatStatisticalData& b)
+{
+    return ((0 == memcmp(&a.value, &b.value, sizeof(FloatType))) &&
+            same_nday(a.ten_day, b.ten_day)                       &&
+            same_nday(a.fifty_day, b.fifty_day)                   );
+}
+
+
+#endif // BATCHED_ACCUMULATOR_H
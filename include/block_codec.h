@@ -0,0 +1,93 @@
+#ifndef BLOCK_CODEC_H
+#define BLOCK_CODEC_H
+
+#include <string.h>
+#include <stddef.h>
+
+//  RecordLayout
+//      Identifies the record type of a binary file in its FileHeader
+//      (see file_header.h). Never renumber, only add.
+//
+enum RecordLayout
+{
+    layout_unknown             = 0,
+    layout_real                = 1,
+    layout_integer             = 2,
+    layout_tick                = 3,
+    layout_n_day               = 4,
+    layout_statistical_data    = 5,
+    layout_correlations        = 6,
+    layout_row_col_pair        = 7,
+    layout_banked_correlations = 8,
+    layout_banked_statistical_data = 9,
+    layout_ewma_statistical_data   = 10,
+    layout_ewma_correlations       = 11,
+    layout_checkpoint              = 12,
+    layout_tick_store              = 13,
+    layout_day_rows                = 14,
+    layout_window_validity         = 15,
+
+    // or'd with the layout of the value.
+    layout_date_indexed        = 0x100,
+
+    // or'd with the layout of the records when they're stored
+    // as encoded blocks (see record_encoding.h).
+    layout_encoded             = 0x200
+};
+
+//  BlockCodec
+//      Describe the binary file record of a type, so that containers
+//      of it can be loaded and saved a block at a time rather than
+//      through one stream operator call per field (see container_io.h).
+//      Specialize next to the type's stream operators. The record has
+//      to be byte for byte what operator<< writes in binary mode.
+//      enabled - false here: no block form, use the stream operators.
+//
+template<class T>
+struct BlockCodec
+{
+    static const bool enabled = false;
+};
+
+//  DirectBlockCodec
+//      Block form of a type whose bytes in memory are its file record
+//      (the ones whose operator<< writes sizeof(T) from &t).
+//      Derive a BlockCodec specialization from it.
+//      Layout    - RecordLayout of T.
+//      RealWidth - bytes per floating point value in T, 0 for none.
+//
+template<class T, int Layout, int RealWidth = 0>
+struct DirectBlockCodec
+{
+    static const bool enabled = true;
+    static const int  layout  = Layout;
+
+    //  real_width
+    //      Bytes per floating point value in the record.
+    //
+    inline static int real_width() { return RealWidth; }
+
+    //  size
+    //      Bytes per record in the file.
+    //
+    inline static size_t size() { return sizeof(T); }
+
+    //  pack
+    //      Copy a record into a file buffer.
+    //
+    inline static void pack(const T& t, char * out)
+    {
+        memcpy(out, (const void *)(&t), sizeof(T));
+    }
+
+    //  unpack
+    //      Copy a record out of a file buffer.
+    //
+    inline static void unpack(const char * in, T& t)
+    {
+        memcpy((void *)(&t), in, sizeof(T));
+    }
+};
+
+
+#endif // BLOCK_CODEC_H
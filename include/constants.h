@@ -11,6 +11,13 @@ namespace constants
     PathMaker data_path("/home/tom/Source/Correlator3/data");
     PathMaker means_path("/home/tom/Source/Correlator3/means");
     PathMaker correlations_path("/home/tom/Source/Correlator3/correlations");
+
+    // The same directories, open, for I/O that doesn't depend on
+    // the working directory (see Directory).
+    Directory lists_dir(lists_path.base_path());
+    Directory data_dir(data_path.base_path());
+    Directory means_dir(means_path.base_path());
+    Directory correlations_dir(correlations_path.base_path());
     
     // Start and end dates of data
     using namespace boost::gregorian;
@@ -23,9 +30,41 @@ namespace constants
     const string deltaclosenobkg = "deltaclosenobkg";
     const string deltaadjclosenobkg = "deltaadjclosenobkg";
     const string& corellating = deltaadjclosenobkg;
+
+    // Prefix for the window bank version of the files above.
+    const string window_bank_prefix = "bank.";
+
+    // Prefix for the exponentially weighted version of the files above.
+    const string ewma_prefix = "ewma.";
+
+    // Global ids of the rows of the exponentially weighted files, in
+    // each day's means directory (see DayRows). Each ewma.<date>
+    // result has its own, named with day_rows_suffix.
+    const string ewma_rows = "ewma.rows";
+
+    // All of the closes in one file, written by getdata (in the data path).
+    const string tick_store = "ticks.store";
+
+    // Global symbol ids, one symbol a line, only ever appended to, and
+    // the suffix of each day's rows by global id (in the lists path).
+    const string symbol_ids = "SymbolIds.txt";
+    const string day_rows_suffix = ".rows";
+
+    // Which days of each row's windows really traded, for
+    // correlate --pairwise (in each day's means directory), and the
+    // prefix of its results.
+    const string window_validity = "validity";
+    const string pairwise_prefix = "pairwise.";
+
+    // Accumulator state left by preprocess for --append (in the means path).
+    const string checkpoint = "checkpoint";
     
     // Work with plain text or binary?
     bool save_as_binary = true;
+
+    // Write binary records that have a compact encoded form (ticks)
+    // encoded? Both forms are always read.
+    bool save_encoded = true;
 }
 
 #endif // CONSTANTS_H
@@ -4,27 +4,40 @@
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <vector>
+#include <algorithm>
+#include <list>
+#include <sstream>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
 #include "constants.h"
+#include "numerictypes.h"
+#include "block_codec.h"
+#include "file_header.h"
+#include "record_encoding.h"
 
 using namespace std;
 
 //  Archiving
 //      Use standard fstreams to save and load files from/to text.
+//      In binary mode, types with a BlockCodec (see block_codec.h)
+//      are moved a block of records at a time instead, after a
+//      FileHeader (see file_header.h). Types with a RecordEncoding
+//      (see record_encoding.h) are written encoded when
+//      constants::save_encoded is set; either form is read.
 //
-//  load_from
-//      Load from a text file, one element per "line."
+//  load_elements_from
+//      Load the rest of an open stream, one element per "line."
+//      Text files and types without a block form.
 //      c        - container for the data.
-//      filename - text file to read in.
+//      iFile    - stream to read from.
 //
 template<class STL_Container>
-void load_from(STL_Container& c, const char * filename)
+void load_elements_from(STL_Container& c, istream& iFile)
 {
     if (!c.empty()) c.clear();
     
-    ios_base::openmode iomode = ios_base::in;
-    if(constants::save_as_binary) iomode |= ios_base::binary;
-    
-    ifstream iFile(filename, iomode);
     istream_iterator<typename STL_Container::value_type> itt(iFile);
     istream_iterator<typename STL_Container::value_type> eos;
     while(itt != eos)
@@ -34,27 +47,270 @@ void load_from(STL_Container& c, const char * filename)
     }
 }
 
+//  block_bytes
+//  block_records
+//      Size of the buffer used by the block functions,
+//      and the number of records that fit in it.
+//
+const size_t block_bytes = 1 << 20;
+
+template<class Codec>
+inline size_t block_records()
+{
+    size_t records = block_bytes / Codec::size();
+    return (0 < records) ? records : 1;
+}
+
+//  load_block_from
+//      Load the rest of an open binary stream. Sizes the container
+//      once from the bytes left (or the header's count if smaller),
+//      then reads a block of records per call. A partial record at
+//      the end is dropped.
+//      c        - container for the data.
+//      iFile    - stream to read from (must be seekable).
+//      expected - record count from the file header, if there is one.
+//
+template<class STL_Container>
+void load_block_from(STL_Container& c,
+                     istream&       iFile,
+                     uint64_t       expected = UINT64_MAX)
+{
+    typedef typename STL_Container::value_type T;
+    typedef BlockCodec<T>                      Codec;
+
+    if (!c.empty()) c.clear();
+
+    streampos begin = iFile.tellg();
+    iFile.seekg(0, ios_base::end);
+    streampos end = iFile.tellg();
+    iFile.seekg(begin);
+    if ((0 > begin) || (end < begin) || !iFile.good()) return;
+
+    size_t count = size_t(end - begin) / Codec::size();
+    if (expected < count) count = expected;
+    c.resize(count);
+
+    vector<char> buffer(min(count, block_records<Codec>()) * Codec::size());
+
+    typename STL_Container::iterator it = c.begin();
+    size_t done = 0;
+    while (done < count)
+    {
+        size_t records = min(count - done, block_records<Codec>());
+        iFile.read(&buffer[0], records * Codec::size());
+
+        records = size_t(iFile.gcount()) / Codec::size();
+        for (size_t i = 0; i < records; ++i, ++it)
+            Codec::unpack(&buffer[i * Codec::size()], *it);
+        done += records;
+
+        if (!iFile.good()) break;
+    }
+
+    // Short read - keep what made it.
+    if (done < count) c.resize(done);
+}
+
+//  load_from
+//      Load the rest of an open stream.
+//      c        - container for the data.
+//      iFile    - stream to read from.
+//      returns false (with c empty) if the file header says the
+//      records aren't the type being loaded.
+//
+template<class STL_Container>
+bool load_from(STL_Container& c, istream& iFile)
+{
+    typedef typename STL_Container::value_type T;
+
+    if constexpr (BlockCodec<T>::enabled)
+    {
+        if (constants::save_as_binary)
+        {
+            FileHeader header;
+            if (!header.load(iFile))
+                load_block_from(c, iFile);
+            else if (header.matches<T>())
+                load_block_from(c, iFile, header.count);
+            else
+            {
+                if constexpr (RecordEncoding<T>::enabled)
+                {
+                    if (header.matches<T>(true))
+                    {
+                        load_encoded_from(c, iFile, header.count);
+                        return true;
+                    }
+                }
+                if (!c.empty()) c.clear();
+                return false;
+            }
+            return true;
+        }
+    }
+    load_elements_from(c, iFile);
+    return true;
+}
+
+//  load_from
+//      Load from a text file, one element per "line."
+//      c        - container for the data.
+//      filename - text file to read in.
+//
+template<class STL_Container>
+bool load_from(STL_Container& c, const char * filename)
+{
+    ios_base::openmode iomode = ios_base::in;
+    if(constants::save_as_binary) iomode |= ios_base::binary;
+    
+    ifstream iFile(filename, iomode);
+    return load_from(c, iFile);
+}
+
+//  load_from
+//      Load from a file in a directory, one element per "line."
+//      c    - container for the data.
+//      dir  - open directory.
+//      name - file in it.
+//
+template<class STL_Container>
+bool load_from(STL_Container& c, const Directory& dir, const string& name)
+{
+    ios_base::openmode iomode = ios_base::in;
+    if(constants::save_as_binary) iomode |= ios_base::binary;
+
+    InFile iFile(dir, name, iomode);
+    return load_from(c, iFile);
+}
+
+//  save_elements_to
+//      Save the contents of a container to an open stream,
+//      one element at a time.
+//      c        - container for the data.
+//      outfile  - stream to write to.
+//
+template<class STL_Container>
+void save_elements_to(const STL_Container& c, ostream& outfile)
+{
+    ostream_iterator<typename STL_Container::value_type> out_it(outfile);
+    copy(c.begin(), c.end(), out_it);
+}
+
+//  save_block_to
+//      Save the contents of a container to an open binary stream,
+//      a block of records per write call.
+//      c        - container for the data.
+//      outfile  - stream to write to.
+//
+template<class STL_Container>
+void save_block_to(const STL_Container& c, ostream& outfile)
+{
+    typedef typename STL_Container::value_type T;
+    typedef BlockCodec<T>                      Codec;
+
+    vector<char> buffer(min(size_t(c.size()), block_records<Codec>()) *
+                        Codec::size());
+
+    typename STL_Container::const_iterator it = c.begin();
+    size_t done = 0;
+    while (done < c.size())
+    {
+        size_t records = min(c.size() - done, block_records<Codec>());
+        for (size_t i = 0; i < records; ++i, ++it)
+            Codec::pack(*it, &buffer[i * Codec::size()]);
+
+        outfile.write(&buffer[0], records * Codec::size());
+        done += records;
+    }
+}
+
+//  save_to
+//      Save the contents of a container to an open stream.
+//      c        - container for the data.
+//      outfile  - stream to write to.
+//      symbols  - number of symbols covered, for the file header.
+//      date     - date index of the data, for the file header.
+//
+template<class STL_Container>
+void save_to(const STL_Container& c,
+             ostream&             outfile,
+             uint32_t             symbols = 0,
+             int32_t              date = -1)
+{
+    typedef typename STL_Container::value_type T;
+
+    if constexpr (BlockCodec<T>::enabled)
+    {
+        if (constants::save_as_binary)
+        {
+            if constexpr (RecordEncoding<T>::enabled)
+            {
+                if (constants::save_encoded)
+                {
+                    FileHeader::describe<T>(c.size(), symbols, date, true)
+                        .save(outfile);
+                    save_encoded_to(c, outfile);
+                    return;
+                }
+            }
+            FileHeader::describe<T>(c.size(), symbols, date).save(outfile);
+            save_block_to(c, outfile);
+            return;
+        }
+    }
+    save_elements_to(c, outfile);
+}
+
 //  save_to
 //      Save the contents of a vector into a text file. One element per "line."
 //      c        - container for the data.
 //      filename - text file to save to.
 //
 template<class STL_Container>
-void save_to(const STL_Container& c, const char * filename)
+void save_to(const STL_Container& c,
+             const char *         filename,
+             uint32_t             symbols = 0,
+             int32_t              date = -1)
 {
     ios_base::openmode iomode = ios_base::out;
     if(constants::save_as_binary) iomode |= ios_base::binary;
 
     ofstream outfile(filename, iomode);
-    ostream_iterator<typename STL_Container::value_type> out_it(outfile);
-    copy(c.begin(), c.end(), out_it);
+    save_to(c, outfile, symbols, date);
+}
+
+//  save_to
+//      Save the contents of a container into a file in a directory.
+//      c    - container for the data.
+//      dir  - open directory.
+//      name - file in it.
+//
+template<class STL_Container>
+void save_to(const STL_Container& c,
+             const Directory&     dir,
+             const string&        name,
+             uint32_t             symbols = 0,
+             int32_t              date = -1)
+{
+    ios_base::openmode iomode = ios_base::out;
+    if(constants::save_as_binary) iomode |= ios_base::binary;
+
+    OutFile outfile(dir, name, iomode);
+    save_to(c, outfile, symbols, date);
 }
 
 
 //  BufferedRecordReader
 //      Read a particular record out of a file that's a collection
 //      of records.  Optimizes read time and memory and disk allocation.
-//      Developed to work around ext4 minimum block size of 4048 bytes.
+//      Developed to work around ext4 minimum block size of 4048 bytes:
+//      the file is read a whole aligned block at a time with pread,
+//      and the most recently used blocks are kept, so nearby and
+//      repeated lookups don't go back to the file.
+//      Binary files only. An encoded file (see record_encoding.h) has
+//      no fixed record offsets, so it is decoded whole when opened and
+//      read from memory instead; those reads don't count as hits or
+//      misses.
 //      RecordType - Type of record that comprises file.
 //                   RecordType must support copying.
 //
@@ -62,48 +318,98 @@ template< class RecordType >
 class BufferedRecordReader
 {
 public:
+    //  default_block_size
+    //  default_cache_blocks
+    //      One ext4 block per read, 256 blocks (1 MiB) kept.
+    //
+    static const size_t default_block_size   = 4096;
+    static const size_t default_cache_blocks = 256;
+
     //  Constructor
+    //      block_size   - bytes per read.
+    //      cache_blocks - number of blocks to keep.
     //
-    inline BufferedRecordReader() { }
+    inline BufferedRecordReader(size_t block_size   = default_block_size,
+                                size_t cache_blocks = default_cache_blocks) :
+        _fd(-1),
+        _block_size(block_size),
+        _cache_blocks(max(cache_blocks, size_t(1))),
+        _record(record_size()),
+        _hits(0),
+        _misses(0),
+        _encoded(false) { }
 
     //  Construct and open a file.
-    //      filename - file to attempt opening.
+    //      filename     - file to attempt opening.
+    //      block_size   - bytes per read.
+    //      cache_blocks - number of blocks to keep.
+    //
+    inline BufferedRecordReader(const char * filename,
+                                size_t block_size   = default_block_size,
+                                size_t cache_blocks = default_cache_blocks) :
+        _fd(-1),
+        _block_size(block_size),
+        _cache_blocks(max(cache_blocks, size_t(1))),
+        _record(record_size()),
+        _hits(0),
+        _misses(0),
+        _encoded(false)
+    {
+        open(filename);
+    }
+
+    //  Destructor
     //
-    inline BufferedRecordReader(const char * filename) : _file(filename) { }
+    inline ~BufferedRecordReader() { close(); }
 
     // Status Functions
 
     //  is_open
     //      Return true if file is open.
     //
-    inline bool is_open() { return _file.is_open(); }
+    inline bool is_open() { return (0 <= _fd); }
 
-    // maybe add a bunch more for debugging if neccessary...
+    //  hits
+    //  misses
+    //      Block lookups found in the cache / read from the file.
+    //
+    inline size_t hits() const   { return _hits;   }
+    inline size_t misses() const { return _misses; }
+
+    //  reset_counters
+    //      Zero the hit and miss counts.
+    //
+    inline void reset_counters() { _hits = _misses = 0; }
 
     // Utility Functions
     
     //  close
-    //      Close the file if it's open & invalidate the index.
+    //      Close the file if it's open & drop the cached blocks.
     //
     inline void close()
     {
-        if(_file.is_open()) _file.close();
-        _lastread = IntType::invalid_value;
+        if (0 <= _fd) ::close(_fd);
+        _fd = -1;
+        _blocks.clear();
+        _lookup.clear();
+        _encoded = false;
+        _decoded.clear();
     }
 
     //  open
-    //      Close any open file, reset the last index to invalid,
+    //      Close any open file, drop the cached blocks,
     //      and open up the new file.
     //      filename - file to attempt opening.
     //      return true if file is open.
     //
     bool open(const char * filename)
     {
-        // close the last file and mark the buffer as unread.
         close();
         
-        _file.open(filename);
-        return _file.is_open();
+        _fd = ::open(filename, O_RDONLY);
+        skip_header();
+        if (_encoded) decode(filename);
+        return is_open();
     }
 
     //  read
@@ -112,54 +418,242 @@ public:
     //      out     - Destination for the data.
     //                RecordType must support copying.
     //      returns true if data read into the destination object.
-    //      returns false if file not open, istream not good,
-    //                       index < 0, or read failed.
+    //      returns false if file not open, index < 0,
+    //                       or the record is past the end of the file.
     //
     bool read(int index, RecordType& out)
     {
-        if( (!_file.is_open()) ||
-            (!_file.good())    ||
-            (0 > index)        ) return false;
-        
-        // return last read data if asked for it again.
-        if(index == _lastread)
+        if( (!is_open()) ||
+            (0 > index)  ) return false;
+
+        if (_encoded)
         {
-            out = _buffer;
+            if (_decoded.size() <= size_t(index)) return false;
+
+            out = _decoded[index];
             return true;
         }
 
         // Zero-based indexing
-        _file.seekg(index * RecordType::Size());
+        uint64_t first = uint64_t(_offset) + uint64_t(index) * record_size();
 
-        if(_file.good())
+        // Gather the record, it may straddle blocks.
+        char * record = &_record[0];
+        size_t got = 0;
+        while (got < record_size())
         {
-            // Read new indexed data into the buffer.
-            _file >> _buffer;
+            uint64_t    position = first + got;
+            const Block * block  = fetch(position / _block_size);
+            if (0 == block) return false;
+
+            size_t within = position % _block_size;
+            if (block->length <= within) return false;
 
-            if(_file.good())
+            size_t n = min(record_size() - got, block->length - within);
+            memcpy(record + got, &block->data[within], n);
+            got += n;
+        }
+
+        unpack(record, out);
+        return true;
+    }
+
+protected:
+    //  Block
+    //      A cached block of the file.
+    //      number - block number (file offset / block size).
+    //      length - bytes read, short for the last block.
+    //
+    struct Block
+    {
+        uint64_t     number;
+        size_t       length;
+        vector<char> data;
+    };
+
+    typedef list<Block>                                         BlockList;
+    typedef unordered_map<uint64_t, typename BlockList::iterator> BlockMap;
+
+    //  record_size
+    //      Bytes per record in the file.
+    //
+    inline static size_t record_size()
+    {
+        if constexpr (BlockCodec<RecordType>::enabled)
+            return BlockCodec<RecordType>::size();
+        else
+            return RecordType::Size();
+    }
+
+    //  unpack
+    //      Copy a record out of its file bytes.
+    //
+    inline static void unpack(const char * record, RecordType& out)
+    {
+        if constexpr (BlockCodec<RecordType>::enabled)
+            BlockCodec<RecordType>::unpack(record, out);
+        else
+        {
+            istringstream in(string(record, record_size()));
+            in >> out;
+        }
+    }
+
+    //  fetch
+    //      Find a block in the cache or read it in, evicting the
+    //      least recently used block if the cache is full.
+    //      number - block number.
+    //      returns the block or 0 if it couldn't be read.
+    //
+    const Block * fetch(uint64_t number)
+    {
+        typename BlockMap::iterator found = _lookup.find(number);
+        if (_lookup.end() != found)
+        {
+            ++_hits;
+            _blocks.splice(_blocks.begin(), _blocks, found->second);
+            return &_blocks.front();
+        }
+
+        ++_misses;
+        if (_blocks.size() >= _cache_blocks)
+        {
+            // Reuse the oldest block's buffer.
+            _lookup.erase(_blocks.back().number);
+            _blocks.splice(_blocks.begin(), _blocks, --_blocks.end());
+        }
+        else
+            _blocks.push_front(Block());
+
+        Block& block = _blocks.front();
+        block.number = number;
+        block.data.resize(_block_size);
+
+        ssize_t n = ::pread(_fd, &block.data[0], _block_size,
+                            off_t(number * _block_size));
+        if (0 >= n)
+        {
+            _blocks.pop_front();
+            return 0;
+        }
+
+        block.length = size_t(n);
+        _lookup[number] = _blocks.begin();
+        return &block;
+    }
+
+    //  skip_header
+    //      Records start after the file header, if there is one.
+    //      A header for some other kind of record gets the file
+    //      closed, as load_from turns it down. An encoded file of
+    //      these records is marked for decode.
+    //
+    void skip_header()
+    {
+        _offset = 0;
+        if (!is_open()) return;
+
+        char       bytes[sizeof(FileHeader)];
+        FileHeader header;
+        ssize_t    n = ::pread(_fd, bytes, sizeof(bytes), 0);
+        if ((0 < n) && header.load(bytes, size_t(n)))
+        {
+            _offset = streamoff(sizeof(FileHeader));
+            if (header.is_encoded())
             {
-                // if no error, store index
-                _lastread = index;
-                out = _buffer;
-                return true;
+                if constexpr (RecordEncoding<RecordType>::enabled)
+                    _encoded = header.matches<RecordType>(true);
+                if (!_encoded) close();
             }
-            else return false;
+            else if (!matches(header))
+                close();
         }
-        else return false;
     }
 
-protected:
-    //  _buffer
-    //  _lastread
-    //      Don't read the same spot twice in a row...
+    //  decode
+    //      Read the whole of an encoded file into _decoded, closing
+    //      the file if it doesn't hold the records its header counts.
+    //      filename - the open file.
+    //
+    void decode(const char * filename)
+    {
+        if constexpr (RecordEncoding<RecordType>::enabled)
+        {
+            ifstream   in(filename, ios_base::in | ios_base::binary);
+            FileHeader header;
+            if (header.load(in))
+            {
+                load_encoded_from(_decoded, in, header.count);
+                if (header.count == _decoded.size()) return;
+            }
+        }
+        close();
+    }
+
+    //  matches
+    //      Return true if a file header describes the records read
+    //      here. Without a block form only the record size, version
+    //      and byte order can be checked.
+    //
+    inline static bool matches(const FileHeader& header)
+    {
+        if constexpr (BlockCodec<RecordType>::enabled)
+            return header.matches<RecordType>();
+        else
+            return ((FileHeader::current_version >= header.version)  &&
+                    (record_size() == header.record_size)            &&
+                    (FileHeader::endian_marker == header.endian)     );
+    }
+
+    //  _fd
+    //      Open file.
+    //
+    int         _fd;
+
+    //  _offset
+    //      Position of the first record.
+    //
+    streamoff   _offset;
+
+    //  _block_size
+    //  _cache_blocks
+    //      Bytes per block and blocks kept.
+    //
+    size_t      _block_size;
+    size_t      _cache_blocks;
+
+    //  _blocks
+    //  _lookup
+    //      Cached blocks, most recently used first, and an index
+    //      into them by block number.
+    //
+    BlockList   _blocks;
+    BlockMap    _lookup;
+
+    //  _record
+    //      Bytes of the record being read.
+    //
+    vector<char> _record;
+
+    //  _hits
+    //  _misses
+    //      Cache statistics.
+    //
+    size_t      _hits;
+    size_t      _misses;
+
+    //  _encoded
+    //  _decoded
+    //      The file is encoded, and its records.
     //
-    RecordType  _buffer;
-    IntType     _lastread;
+    bool               _encoded;
+    vector<RecordType> _decoded;
 
-    //  _file
-    //      Input stream.
+private:
+    //  Do Not Copy
     //
-    ifstream _file;
+    BufferedRecordReader(const BufferedRecordReader&);
+    BufferedRecordReader& operator=(const BufferedRecordReader&);
 };
 
 
@@ -2,6 +2,8 @@
 #define CORRELATIONS_H
 
 #include "source_data.h"
+#include "masked_signal.h"
+#include "window_validity.h"
 #include <boost/thread.hpp>
 
 //  Correlations
@@ -155,6 +157,15 @@ istream& operator>> (istream& in, Correlations<Real>& c)
     return in;
 }
 
+//  BlockCodec
+//      Correlations are stored as is.
+//
+template<class Real>
+struct BlockCodec< Correlations<Real> > :
+    public DirectBlockCodec< Correlations<Real>,
+                             layout_correlations,
+                             sizeof(Real) > { };
+
 typedef Correlations< FloatType  > FloatCorrelations;
 typedef Correlations< DoubleType > DoubleCorrelations;
 
@@ -212,6 +223,13 @@ istream& operator>> (istream& in, RowColPair& rc)
     return in;
 }
 
+//  BlockCodec
+//      Stored as is.
+//
+template<>
+struct BlockCodec<RowColPair> :
+    public DirectBlockCodec<RowColPair, layout_row_col_pair> { };
+
 typedef vector<RowColPair> RowColVector;
 
 
@@ -221,20 +239,21 @@ typedef vector<RowColPair> RowColVector;
 //      on the diagonal (skipping the diagonal).
 //      Since every element will be assigned in the loop, probably don't need
 //      to assign NaN's to all of the elements between cross-correlations.
+//      Corrs - the element type, Correlations< Real > by default.
 //
-template< class Real >
+template< class Real, class Corrs = Correlations< Real > >
 class CrossCorrelation
 {
 public:
     //  CorrelationsType
-    //      Contain a pair of correlations.
+    //      Contain a pair (or a bank) of correlations.
     //
-    typedef Correlations< Real > CorrelationsType;
+    typedef Corrs                CorrelationsType;
     typedef CorrelationsType&    CorrelationsRef;
 
     //  Default Constructor - must resize!
     //
-    inline CrossCorrelation() : _queued_element(1, 0, 0) { }
+    inline CrossCorrelation() : _queued_element(1, 0, 0), _elements(0) { }
     
     //  Constructor
     //      Allocates room for the cross-correlations of "elements" elements.
@@ -244,7 +263,8 @@ public:
     //
     inline CrossCorrelation(unsigned int elements) : 
         _queued_element(1, 0, 0),
-        _slice(sum_first_n_numbers(elements - 1))
+        _slice(sum_first_n_numbers(elements - 1)),
+        _elements(elements)
     { }
 
     //  size_for
@@ -261,6 +281,7 @@ public:
         _queued_element.index  = 0;
 
         _slice.resize(sum_first_n_numbers(elements - 1));
+        _elements = elements;
     }
     
     //  size
@@ -277,7 +298,7 @@ public:
     //      to something outside of the lower triangle
     //      of a symmetric matrix (below the diagonal).
     //
-    CorrelationsRef at(const RowColPair& rc) throw (out_of_range)
+    CorrelationsRef at(const RowColPair& rc) noexcept(false)
     {
         if(_slice.empty()) 
             throw out_of_range("Empty slice! Get a new can...");
@@ -305,7 +326,7 @@ public:
     //      returns a reference to an element in the slice.
     //      Throws out_of_range if index is past the end of the slice. 
     //
-    CorrelationsRef at(const unsigned int index) throw (out_of_range)
+    CorrelationsRef at(const unsigned int index) noexcept(false)
     {
         // make sure index is within the slice.
         if (_slice.size() <= index) 
@@ -381,26 +402,68 @@ public:
     //  save_to
     //      Save to a text file using STL fstreams.
     //      filename - target file.
+    //      date     - date index of the slice, for the file header.
+    //
+    void save_to(const char * filename, int date = -1)
+    {
+        ::save_to(_slice, filename, _elements, date);
+    }
+
+    //  save_to
+    //      Save to an open stream (after a header, say).
+    //      out  - target stream.
+    //      date - date index of the slice, for the file header.
     //
-    void save_to(const char * filename)
+    void save_to(ostream& out, int date = -1)
     {
-        ::save_to(_slice, filename);
+        ::save_to(_slice, out, _elements, date);
+    }
+
+    //  save_to
+    //      Save to a file in a directory.
+    //      dir  - open directory.
+    //      name - file in it.
+    //      date - date index of the slice, for the file header.
+    //
+    void save_to(const Directory& dir, const string& name, int date = -1)
+    {
+        ::save_to(_slice, dir, name, _elements, date);
     }
 
     //  load_from
     //      Load from a text file using STL fstreams.
     //      filename - source file.
+    //      returns false if the file holds some other kind of record.
+    //
+    bool load_from(const char * filename)
+    {
+        return ::load_from(_slice, filename);
+    }
+
+    //  load_from
+    //      Load from a file in a directory.
+    //      dir  - open directory.
+    //      name - file in it.
     //
-    void load_from(const char * filename)
+    bool load_from(const Directory& dir, const string& name)
     {
-        ::load_from(_slice, filename);
+        return ::load_from(_slice, dir, name);
+    }
+
+    //  load_from
+    //      Load the rest of an open stream.
+    //      in - source stream.
+    //
+    bool load_from(istream& in)
+    {
+        return ::load_from(_slice, in);
     }
 
 protected:
     //  _slice
     //      Defines the base container. This is the slice.
     //
-    vector< Correlations< Real >  > _slice;
+    vector< CorrelationsType > _slice;
 
     //  _queued_element
     //      Current queued visitor - used to drive a thread pool.
@@ -412,6 +475,11 @@ protected:
     //
     boost::mutex _queue_mutex;
 
+    //  _elements
+    //      Number of elements being cross-correlated.
+    //
+    unsigned int _elements;
+
 private:
     //  Do Not Copy (this is likely a large chunk of memory)
     //
@@ -537,6 +605,182 @@ typedef Correlator< FloatType  > FloatCorrelator;
 typedef Correlator< DoubleType > DoubleCorrelator;
 
 
+//  MaskedStatisticalRow
+//      A row of a day's statistical data and the days of its windows
+//      the symbol really traded on (see WindowValidity).
+//
+struct MaskedStatisticalRow
+{
+    const FloatStatisticalData& data;
+    uint64_t                    valid;
+
+    inline MaskedStatisticalRow(const FloatStatisticalData& d, uint64_t v) :
+        data(d), valid(v) { }
+};
+
+
+//  MaskedStatisticalDeque
+//      A day's statistical data and its window validity, row by row.
+//
+struct MaskedStatisticalDeque
+{
+    FloatStatisticalDeque data;
+    WindowValidity        valid;
+
+    inline size_t size() const { return data.size(); }
+
+    inline MaskedStatisticalRow operator[](size_t row) const
+    {
+        return MaskedStatisticalRow(data[row], valid[row]);
+    }
+};
+
+
+//  MaskedCorrelatorN
+//      Correlate two N-day moving averages over just the days both
+//      symbols traded on (pairwise complete): the overlap is the and
+//      of their validity bits, counted with a popcount, and the
+//      moments are masked sums over it (see masked_moments), each pair
+//      centred on its own mean over the overlap. A pair sharing the
+//      whole window gets CorrelatorN's result; one sharing fewer than
+//      min_overlap days gets none.
+//
+template<int N>
+class MaskedCorrelatorN
+{
+public:
+    typedef NDayType<FloatType, N> NDay;
+
+    //  Constructor
+    //
+    inline MaskedCorrelatorN() { }
+
+    //  min_overlap
+    //      Days two windows must share to be correlated. Shared by
+    //      all correlators (set it before starting threads).
+    //
+    inline static void min_overlap(int days) { s_min_overlap = days; }
+    inline static int min_overlap() { return s_min_overlap; }
+
+    //  compute
+    //      nd_one, nd_two - the moving averages.
+    //      valid          - days both traded on, bit i for residual[i].
+    //      Returns the correlation coefficient over those days, or
+    //      FloatType::invalid_value.
+    //
+    FloatType compute(const NDay& nd_one, const NDay& nd_two, uint64_t valid)
+    {
+        if ((FloatType::is_invalid(nd_one.root_mean_square)) ||
+            (FloatType::is_invalid(nd_two.root_mean_square)) )
+            return FloatType::invalid_value;
+
+        if (((uint64_t(1) << N) - 1) == valid)
+            return _dense.compute(nd_one, nd_two);
+
+        if (s_min_overlap > __builtin_popcountll(valid))
+            return FloatType::invalid_value;
+
+        // Correlation is the same around any mean, so the residuals
+        // do as the values.
+        MaskedMoments m;
+        masked_moments(&(nd_one.residual[0].value),
+                       &(nd_two.residual[0].value), &valid, N, m);
+
+        float covariance = m.xy - m.x * m.y / m.count;
+        float divisor    = sqrt((m.xx - m.x * m.x / m.count) *
+                                (m.yy - m.y * m.y / m.count));
+
+        //  Check for divide by zero (or a variance rounded below it).
+        if (!(FloatType::Limits::min() <= divisor))
+            return FloatType::invalid_value;
+
+        return FloatType(covariance / divisor);
+    }
+
+protected:
+    //  _dense
+    //      For pairs that share the whole window.
+    //
+    CorrelatorN<FloatType, N> _dense;
+
+    //  s_min_overlap
+    //
+    static int s_min_overlap;
+
+    //  Do Not Copy
+    //
+    inline MaskedCorrelatorN(const MaskedCorrelatorN&) { }
+};
+
+//  s_min_overlap
+//      Half the window by default.
+//
+template<int N>
+int MaskedCorrelatorN<N>::s_min_overlap((N + 1) / 2);
+
+
+//  MaskedCorrelator
+//      Correlator for MaskedStatisticalRows.
+//
+class MaskedCorrelator
+{
+public:
+    //  Constructor
+    //
+    inline MaskedCorrelator() { }
+
+    //  min_overlap
+    //      Set the days each window needs shared from a fraction of
+    //      its length, at least 3 (2 always correlate perfectly).
+    //
+    static void min_overlap(double fraction)
+    {
+        MaskedCorrelatorN<10>::min_overlap(overlap_days(fraction, 10));
+        MaskedCorrelatorN<50>::min_overlap(overlap_days(fraction, 50));
+    }
+
+    //  compute
+    //      Compute the correlations between two sets of moving
+    //      averages over the days both traded on.
+    //
+    inline void compute(FloatCorrelations&          cs,
+                        const MaskedStatisticalRow& sd_one,
+                        const MaskedStatisticalRow& sd_two)
+    {
+        uint64_t valid = sd_one.valid & sd_two.valid;
+
+        cs.ten_day =
+            ten_day_correlator.compute(sd_one.data.ten_day,
+                                       sd_two.data.ten_day,
+                                       WindowValidity::window<10>(valid));
+
+        cs.fifty_day =
+            fifty_day_correlator.compute(sd_one.data.fifty_day,
+                                         sd_two.data.fifty_day,
+                                         WindowValidity::window<50>(valid));
+    }
+
+protected:
+    inline static int overlap_days(double fraction, int n)
+    {
+        int days = int(ceil(fraction * n));
+        return (3 > days) ? 3 : ((n < days) ? n : days);
+    }
+
+    //  *_day_correlator
+    //      Compute the correlations for an *-Day moving average.
+    //
+    MaskedCorrelatorN<10> ten_day_correlator;
+    MaskedCorrelatorN<50> fifty_day_correlator;
+
+    //  Do Not Copy
+    //
+    inline MaskedCorrelator(const MaskedCorrelator&) { }
+};
+
+typedef MaskedCorrelator FloatMaskedCorrelator;
+
+
 
 
 #endif // CORRELATIONS_H
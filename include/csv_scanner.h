@@ -0,0 +1,266 @@
+#ifndef CSV_SCANNER_H
+#define CSV_SCANNER_H
+
+#include <stdint.h>
+#include <string.h>
+#include <string_view>
+#include <vector>
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+//  ScalarBytes
+//      Compare bytes against a character one at a time, on any
+//      machine. ByteLanes falls back to it, and the benchmark uses it
+//      to check and time the vector versions.
+//      width - bytes compared in one step.
+//
+struct ScalarBytes
+{
+    static const int width = 8;
+    struct Vector { char c[width]; };
+
+    static inline Vector load(const char * p)
+    {
+        Vector v;
+        ::memcpy(v.c, p, width);
+        return v;
+    }
+    static inline Vector set1(char c)
+    {
+        Vector v;
+        ::memset(v.c, c, width);
+        return v;
+    }
+
+    //  equal
+    //      Bit i set where byte i of a is byte i of b.
+    //
+    static inline uint64_t equal(const Vector& a, const Vector& b)
+    {
+        uint64_t bits = 0;
+        for (int i = 0; i < width; ++i)
+            bits |= uint64_t(a.c[i] == b.c[i]) << i;
+        return bits;
+    }
+};
+
+//  ByteLanes
+//      ScalarBytes in the widest register available at compile time,
+//      as FloatLanes is for floats (see batched_accumulator.h): AVX2
+//      when built with -mavx2 or -march=native, SSE2 on any x86-64,
+//      otherwise the scalar loop.
+//
+#if defined(__AVX2__)
+
+struct ByteLanes
+{
+    static const int width = 32;
+    typedef __m256i Vector;
+
+    static inline Vector load(const char * p)
+    {
+        return _mm256_loadu_si256((const __m256i *)(p));
+    }
+    static inline Vector set1(char c)       { return _mm256_set1_epi8(c); }
+    static inline uint64_t equal(Vector a, Vector b)
+    {
+        return uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b)));
+    }
+};
+
+#elif defined(__SSE2__)
+
+struct ByteLanes
+{
+    static const int width = 16;
+    typedef __m128i Vector;
+
+    static inline Vector load(const char * p)
+    {
+        return _mm_loadu_si128((const __m128i *)(p));
+    }
+    static inline Vector set1(char c)       { return _mm_set1_epi8(c); }
+    static inline uint64_t equal(Vector a, Vector b)
+    {
+        return uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(a, b))) & 0xffff;
+    }
+};
+
+#else
+
+typedef ScalarBytes ByteLanes;
+
+#endif
+
+
+//  StructuralScanner
+//      Find the delimiters, quotes and newlines of a text 64 bytes at
+//      a time, as bit masks (in the manner of simdjson and simdcsv),
+//      and split it into lines of fields from the set bits alone. The
+//      bytes between are never looked at one by one.
+//
+//      Quotes aren't resolved here. A line with a quote in it is
+//      handed on whole, marked quoted, for the caller to split the
+//      slow way; CSV from Yahoo! has none.
+//
+//      Lanes - ByteLanes, or ScalarBytes.
+//
+template<class Lanes = ByteLanes>
+class StructuralScanner
+{
+public:
+    static const int block      = 64;
+    static const int max_delims = 4;
+
+    //  Constructor
+    //      delims - delimiters for each line (',' for CSV files, etc.),
+    //               up to max_delims of them.
+    //
+    inline StructuralScanner(const char * delims) :
+        _newline(Lanes::set1('\n')),
+        _quote(Lanes::set1('"')),
+        _delim_count(0)
+    {
+        for (const char * d = delims; (0 != *d) && (max_delims > _delim_count); ++d)
+            _delims[_delim_count++] = Lanes::set1(*d);
+    }
+
+    //  BlockMasks
+    //      Bit i is set where byte i of a block is a delimiter, a
+    //      quote or a newline.
+    //
+    struct BlockMasks
+    {
+        uint64_t delimiter;
+        uint64_t quote;
+        uint64_t newline;
+    };
+
+    //  masks
+    //      Classify a block.
+    //      p - 64 bytes.
+    //
+    inline BlockMasks masks(const char * p) const
+    {
+        BlockMasks m = { 0, 0, 0 };
+        for (int k = 0; k < block; k += Lanes::width)
+        {
+            typename Lanes::Vector v = Lanes::load(p + k);
+
+            m.newline |= Lanes::equal(v, _newline) << k;
+            m.quote   |= Lanes::equal(v, _quote) << k;
+            for (int d = 0; d < _delim_count; ++d)
+                m.delimiter |= Lanes::equal(v, _delims[d]) << k;
+        }
+        return m;
+    }
+
+    //  scan
+    //      Split text into lines and fields, and visit each non-empty
+    //      line:
+    //          void v(string_view line,
+    //                 const vector<string_view>& fields,
+    //                 bool quoted)
+    //      The fields are only good during the call, and only when
+    //      the line isn't quoted.
+    //      text - the lines.
+    //      v    - visitor.
+    //
+    template<class Visitor>
+    void scan(string_view text, Visitor& v)
+    {
+        const char * base = text.data();
+        size_t       size = text.size();
+
+        size_t line_start  = 0;
+        size_t field_start = 0;
+        bool   quoted      = false;
+        _fields.clear();
+
+        for (size_t pos = 0; pos < size; pos += block)
+        {
+            BlockMasks m;
+            if (block <= size - pos)
+                m = masks(base + pos);
+            else
+            {
+                // pad the last block out with bytes that aren't
+                // anything.
+                char tail[block];
+                ::memset(tail, 0, block);
+                ::memcpy(tail, base + pos, size - pos);
+                m = masks(tail);
+            }
+
+            uint64_t structural = m.delimiter | m.quote | m.newline;
+            while (0 != structural)
+            {
+                int      bit = __builtin_ctzll(structural);
+                uint64_t one = uint64_t(1) << bit;
+                size_t   i   = pos + bit;
+                structural &= structural - 1;
+
+                if (0 != (m.newline & one))
+                {
+                    if (line_start < i)
+                    {
+                        _fields.push_back(string_view(base + field_start,
+                                                      i - field_start));
+                        v(string_view(base + line_start, i - line_start),
+                          _fields, quoted);
+                    }
+                    _fields.clear();
+                    quoted      = false;
+                    line_start  = i + 1;
+                    field_start = i + 1;
+                }
+                else if (0 != (m.quote & one))
+                {
+                    quoted = true;
+                }
+                else
+                {
+                    _fields.push_back(string_view(base + field_start,
+                                                  i - field_start));
+                    field_start = i + 1;
+                }
+            }
+        }
+
+        // the last line, if it has no newline.
+        if (line_start < size)
+        {
+            _fields.push_back(string_view(base + field_start,
+                                          size - field_start));
+            v(string_view(base + line_start, size - line_start),
+              _fields, quoted);
+        }
+        _fields.clear();
+    }
+
+protected:
+    //  _newline
+    //  _quote
+    //  _delims
+    //      The characters looked for, in every lane.
+    //
+    typename Lanes::Vector _newline;
+    typename Lanes::Vector _quote;
+    typename Lanes::Vector _delims[max_delims];
+    int                    _delim_count;
+
+    //  _fields
+    //      Fields of the current line, reused from line to line.
+    //
+    vector<string_view> _fields;
+
+private:
+    // Do not copy!
+    StructuralScanner(const StructuralScanner&);
+    StructuralScanner& operator=(const StructuralScanner&);
+};
+
+#endif // CSV_SCANNER_H
@@ -5,6 +5,8 @@
 #include "numerictypes.h"
 #include <iostream>
 #include <string>
+#include <string_view>
+#include <vector>
 
 
 // DateIndex
@@ -22,18 +24,66 @@ public:
     typedef int IndexType;
 
     // from_string
-    //      Parse a simple date string (eg. "2010-10-07")
-    //      into a boost::gregorian::date and compute the difference
-    //      from that date to a start date configured in constants.h.
+    //      Compute the difference from a simple date string
+    //      (eg. "2010-10-07") to a start date configured in
+    //      constants.h. ISO dates are read by parse_iso, anything
+    //      else by boost::gregorian::from_simple_string.
+    //      returns -1 if it isn't a date.
     //
-    inline static IndexType from_string(const string& in_date) throw()
+    inline static IndexType from_string(string_view in_date) throw()
     {
+        IndexType index;
+        if (parse_iso(in_date, index)) return index;
+
         try
         {
-            return (int)(boost::gregorian::from_simple_string(in_date).julian_day() - s_zero_date);
+            return (int)(boost::gregorian::from_simple_string(
+                             string(in_date)).julian_day() - s_zero_date);
         }
         catch(...) { return -1; }
     }
+
+    // parse_iso
+    //      Read a date in exactly the ISO form ("2010-10-07") without
+    //      allocating or throwing. Months in the years from the start
+    //      to the end date come from a table, others are worked out.
+    //      in_date - the date.
+    //      index   - set to its index, or to -1 if it can't be a
+    //                date (eg. "2011-02-29"), as boost would.
+    //      returns false if it isn't in the form at all.
+    //
+    inline static bool parse_iso(string_view in_date, IndexType& index) throw()
+    {
+        if ((10 != in_date.size()) ||
+            ('-' != in_date[4])    ||
+            ('-' != in_date[7])) return false;
+
+        // digits, and anything that isn't one comes out over 9.
+        const unsigned char * p = (const unsigned char *)(in_date.data());
+        unsigned y0 = p[0] - '0', y1 = p[1] - '0', y2 = p[2] - '0',
+                 y3 = p[3] - '0', m0 = p[5] - '0', m1 = p[6] - '0',
+                 d0 = p[8] - '0', d1 = p[9] - '0';
+        if ((9 < y0) | (9 < y1) | (9 < y2) | (9 < y3) |
+            (9 < m0) | (9 < m1) | (9 < d0) | (9 < d1)) return false;
+
+        int year  = y0 * 1000 + y1 * 100 + y2 * 10 + y3;
+        int month = m0 * 10 + m1;
+        int day   = d0 * 10 + d1;
+
+        index = -1;
+        if ((1400 > year) || (1 > month) || (12 < month) || (1 > day))
+            return true;
+
+        size_t m = size_t(year - s_first_year) * 12 + month - 1;
+        if ((s_first_year <= year) && (s_month_starts.size() > m + 1))
+        {
+            if (day <= s_month_starts[m + 1] - s_month_starts[m])
+                index = s_month_starts[m] + day - 1;
+        }
+        else if (day <= days_in_month(year, month))
+            index = (IndexType)(julian_day(year, month, day) - s_zero_date);
+        return true;
+    }
     
     // to_string
     //      Create a simple date string (eg. "2010-Oct-07")
@@ -73,10 +123,50 @@ public:
     inline static IndexType last()  { return s_max_index; }
 
 protected:
+    // julian_day
+    //      Julian day number of a Gregorian date.
+    //
+    inline static long julian_day(int year, int month, int day)
+    {
+        int  a = (14 - month) / 12;
+        long y = year + 4800 - a;
+        int  m = month + 12 * a - 3;
+        return day + (153 * m + 2) / 5 + 365 * y + y / 4 - y / 100 + y / 400 - 32045;
+    }
+
+    // days_in_month
+    //
+    inline static int days_in_month(int year, int month)
+    {
+        static const int days[12] = { 31, 28, 31, 30, 31, 30,
+                                      31, 31, 30, 31, 30, 31 };
+        bool leap = (0 == year % 4) && ((0 != year % 100) || (0 == year % 400));
+        return days[month - 1] + ((2 == month) && leap ? 1 : 0);
+    }
+
+    // make_month_starts
+    //      Index of the first of each month of the start date's year
+    //      through the end date's year, and of the month after.
+    //
+    static vector<IndexType> make_month_starts()
+    {
+        vector<IndexType> starts;
+        int last_year = constants::end_date.year();
+        for (int year = s_first_year; year <= last_year; ++year)
+            for (int month = 1; month <= 12; ++month)
+                starts.push_back((IndexType)(julian_day(year, month, 1) - s_zero_date));
+        starts.push_back((IndexType)(julian_day(last_year + 1, 1, 1) - s_zero_date));
+        return starts;
+    }
+
     // beginning Julian Date and max delta.
     static const long s_zero_date;
     static const int s_max_index;
 
+    // the month table parse_iso reads, and the year it starts at.
+    static const int s_first_year;
+    static const vector<IndexType> s_month_starts;
+
 private:
     // static only! do not construct!
     inline DateIndex() { }
@@ -87,6 +177,9 @@ private:
 const long DateIndex::s_zero_date(constants::start_date.julian_day());
 const int DateIndex::s_max_index(
     (DateIndex::IndexType)(constants::end_date.julian_day() - s_zero_date) );
+const int DateIndex::s_first_year(constants::start_date.year());
+const vector<DateIndex::IndexType> DateIndex::s_month_starts(
+    DateIndex::make_month_starts() );
 
 
 //  DateIndexedType
@@ -191,5 +284,35 @@ istream& operator>> (istream& in, DateIndexedType<C>& a)
     return in;
 }
 
+//  BlockCodec
+//      The index followed by the value's record.
+//      Only has a block form if the value does.
+//
+template<class C>
+struct BlockCodec< DateIndexedType<C> >
+{
+    static const bool enabled = BlockCodec<C>::enabled;
+    static const int  layout  = layout_date_indexed | BlockCodec<C>::layout;
+
+    inline static int real_width() { return BlockCodec<C>::real_width(); }
+
+    inline static size_t size()
+    {
+        return sizeof(DateIndex::IndexType) + BlockCodec<C>::size();
+    }
+
+    inline static void pack(const DateIndexedType<C>& a, char * out)
+    {
+        memcpy(out, &(a.index), sizeof(DateIndex::IndexType));
+        BlockCodec<C>::pack(a.value, out + sizeof(DateIndex::IndexType));
+    }
+
+    inline static void unpack(const char * in, DateIndexedType<C>& a)
+    {
+        memcpy(&(a.index), in, sizeof(DateIndex::IndexType));
+        BlockCodec<C>::unpack(in + sizeof(DateIndex::IndexType), a.value);
+    }
+};
+
 #endif // DATE_INDEX_H
 
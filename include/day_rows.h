@@ -0,0 +1,283 @@
+#ifndef DAY_ROWS_H
+#define DAY_ROWS_H
+
+#include "numerictypes.h"
+#include "symbol_table.h"
+#include "file_header.h"
+#include "directories.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+#include <fstream>
+#include <boost/foreach.hpp>
+
+using namespace std;
+
+//  Day Rows
+//      Which symbols have a row in a day's means and correlations,
+//      by global symbol id (the line of the symbol in
+//      lists/SymbolIds.txt, which only ever grows), so a symbol can be
+//      followed from day to day without matching names.
+//
+//      Written by preprocess next to each lists/<date> as
+//      lists/<date>.rows:
+//          FileHeader      - layout_day_rows, symbol_count = global
+//                            ids covered, count = rows, date.
+//          present bitmap  - 64 bit words, bit g set if global id g
+//                            has a row.
+//          rank            - uint32 per word, set bits before it.
+//          ids             - uint32 global id of each row.
+//          rows            - uint32 row of each set bit, in id order.
+//
+//      The row of a global id is then a popcount away:
+//          rows[rank[g / 64] + popcount(present[g / 64] below bit g)]
+//
+class DayRows
+{
+public:
+    //  Constructor
+    //
+    inline DayRows() : _symbols(0), _date(-1) { }
+
+    //  assign
+    //      Set the rows of a day.
+    //      symbols - size of the global id space.
+    //      ids     - global id of each row, in row order, each
+    //                below symbols and at most once.
+    //      date    - date index of the day.
+    //
+    void assign(uint32_t symbols, const vector<SymbolId>& ids, int date)
+    {
+        _symbols = symbols;
+        _date    = date;
+        _ids     = ids;
+        _present.assign(words(), 0);
+        BOOST_FOREACH(SymbolId id, _ids)
+            _present[id / 64] |= uint64_t(1) << (id % 64);
+
+        index();
+    }
+
+    //  size
+    //      Rows in the day.
+    //
+    inline size_t size() const { return _ids.size(); }
+
+    //  symbols
+    //  date
+    //      Global ids covered, and the day.
+    //
+    inline uint32_t symbols() const { return _symbols; }
+    inline int date() const         { return _date; }
+
+    //  contains
+    //      Return true if a global id has a row.
+    //
+    inline bool contains(SymbolId id) const
+    {
+        return (_symbols > id) &&
+               (0 != (_present[id / 64] & (uint64_t(1) << (id % 64))));
+    }
+
+    //  row
+    //      Row of a global id, or -1.
+    //
+    inline int row(SymbolId id) const
+    {
+        if (!contains(id)) return -1;
+
+        uint64_t below = _present[id / 64] & ((uint64_t(1) << (id % 64)) - 1);
+        return int(_rows[_rank[id / 64] + __builtin_popcountll(below)]);
+    }
+
+    //  id
+    //  ids
+    //      Global id of a row, and of every row in order.
+    //
+    inline SymbolId id(int row) const { return _ids[row]; }
+    inline const vector<SymbolId>& ids() const { return _ids; }
+
+    //  save
+    //      Write the rows into a directory.
+    //      returns true if written.
+    //
+    bool save(const Directory& dir, const string& name) const
+    {
+        OutFile out(dir, name, ios_base::out | ios_base::binary);
+        if (!out.is_open()) return false;
+
+        FileHeader header = FileHeader::describe<IntType>(_ids.size(),
+                                                          _symbols, _date);
+        header.layout = layout_day_rows;
+        header.save(out);
+        write(out, _present);
+        write(out, _rank);
+        write(out, _ids);
+        write(out, _rows);
+
+        return out.good();
+    }
+
+    //  load
+    //      Read the rows of a day.
+    //      filename - rows file.
+    //      returns false if missing or damaged; leaves it empty.
+    //
+    bool load(const char * filename)
+    {
+        ifstream in(filename, ios_base::in | ios_base::binary);
+        return load(in);
+    }
+
+    //  load
+    //      Read the rows of a day from a directory.
+    //      dir  - open directory.
+    //      name - rows file in it.
+    //
+    bool load(const Directory& dir, const string& name)
+    {
+        InFile in(dir, name, ios_base::in | ios_base::binary);
+        return load(in);
+    }
+
+    //  load
+    //      Read the rows of a day from an open stream. Only the bitmap
+    //      and the ids are read; the rank and row sections are built
+    //      again from them, so a damaged file can't send row() past
+    //      the end. Each id must be below the ids covered, be there
+    //      once and have its bit set, and the sections must fit in
+    //      what's left of the stream.
+    //
+    bool load(istream& in)
+    {
+        clear();
+
+        FileHeader header;
+        if (!in.good() || !header.load(in))                 return false;
+        if ((FileHeader::current_version < header.version) ||
+            (layout_day_rows != header.layout)             ||
+            (FileHeader::endian_marker != header.endian)   ||
+            (header.count > header.symbol_count)           )  return false;
+
+        streampos begin = in.tellg();
+        in.seekg(0, ios_base::end);
+        streampos end = in.tellg();
+        in.seekg(begin);
+        if ((0 > begin) || (end < begin) || !in.good())      return false;
+
+        uint64_t words = (uint64_t(header.symbol_count) + 63) / 64;
+        uint64_t bytes = words * (sizeof(uint64_t) + sizeof(uint32_t)) +
+                         uint64_t(header.count) * (sizeof(SymbolId) + sizeof(uint32_t));
+        if (uint64_t(end - begin) < bytes)                   return false;
+
+        _symbols = header.symbol_count;
+        _date    = header.date;
+        if (!read(in, _present, words)                                      ||
+            !in.seekg(streamoff(words * sizeof(uint32_t)), ios_base::cur)   ||
+            !read(in, _ids, header.count)                                   ||
+            !distinct(_ids)                                                 )
+        {
+            clear();
+            return false;
+        }
+
+        index();
+        return true;
+    }
+
+    //  clear
+    //
+    void clear()
+    {
+        _symbols = 0;
+        _date    = -1;
+        _present.clear();
+        _rank.clear();
+        _ids.clear();
+        _rows.clear();
+    }
+
+protected:
+    //  words
+    //      64 bit words in the bitmap.
+    //
+    inline size_t words() const { return (size_t(_symbols) + 63) / 64; }
+
+    //  distinct
+    //      Return true if each of some ids is below the ids covered,
+    //      there once, and has its bit set, with no other bits set.
+    //
+    bool distinct(const vector<SymbolId>& ids) const
+    {
+        vector<uint64_t> seen(words(), 0);
+        BOOST_FOREACH(SymbolId id, ids)
+        {
+            if (_symbols <= id) return false;
+
+            uint64_t bit = uint64_t(1) << (id % 64);
+            if (0 != (seen[id / 64] & bit)) return false;
+            seen[id / 64] |= bit;
+        }
+        return seen == _present;
+    }
+
+    //  index
+    //      Count the set bits before each word, and list the rows in
+    //      global id order.
+    //
+    void index()
+    {
+        _rank.resize(words());
+        uint32_t before = 0;
+        for (size_t w = 0; w < words(); ++w)
+        {
+            _rank[w] = before;
+            before  += __builtin_popcountll(_present[w]);
+        }
+
+        _rows.resize(_ids.size());
+        for (uint32_t r = 0; r < _ids.size(); ++r) _rows[r] = r;
+        sort(_rows.begin(), _rows.end(),
+             [this](uint32_t a, uint32_t b) { return _ids[a] < _ids[b]; });
+    }
+
+    template<class T>
+    static void write(ostream& out, const vector<T>& v)
+    {
+        if (!v.empty()) out.write((const char *)(&v[0]), v.size() * sizeof(T));
+    }
+
+    template<class T>
+    static bool read(istream& in, vector<T>& v, size_t count)
+    {
+        v.resize(count);
+        if (!v.empty()) in.read((char *)(&v[0]), v.size() * sizeof(T));
+        return in.good();
+    }
+
+    //  _symbols
+    //  _date
+    //      Global ids covered, and the day.
+    //
+    uint32_t         _symbols;
+    int              _date;
+
+    //  _present
+    //  _rank
+    //      Bitmap of the global ids with a row, and the set bits
+    //      before each word.
+    //
+    vector<uint64_t> _present;
+    vector<uint32_t> _rank;
+
+    //  _ids
+    //  _rows
+    //      Global id of each row, and the rows in global id order.
+    //
+    vector<SymbolId> _ids;
+    vector<uint32_t> _rows;
+};
+
+#endif // DAY_ROWS_H
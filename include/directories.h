@@ -3,7 +3,13 @@
 
 #include <string>
 #include <filesystem>
+#include <istream>
+#include <ostream>
+#include <ext/stdio_filebuf.h>
 #include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
 
 using namespace std;
 
@@ -12,6 +18,9 @@ using namespace std;
 //      changing into other working directories.
 //      Returns user to original directory when done.
 //      Should be used like a singleton...
+//      Changes the directory of the whole process, so no other
+//      thread can be doing file I/O while one of these is around.
+//      Use a Directory instead.
 //
 class WorkingDirectory
 {
@@ -76,13 +85,12 @@ public:
     //      Make a path relative to a base path.
     //      filename - file name appended to base path (base_path/filename)
     //
-    inline const char * operator()(const char * filename) const
+    inline string operator()(const char * filename) const
     {
-        static string datapath(_base_path);
-        datapath = _base_path;
+        string datapath(_base_path);
         datapath += '/';
         datapath += filename;
-        return datapath.c_str();
+        return datapath;
     }
     
     // base_path
@@ -105,5 +113,192 @@ private:
 };
 
 
+// Directory
+//      An open directory. Files are named relative to it and opened
+//      with openat and friends, so nothing depends on the working
+//      directory and any number of threads can share one.
+//      Names may have slashes in them (eg. "MSFT/ticks").
+//
+class Directory
+{
+public:
+    // Constructor
+    //      Open a directory.
+    //      Check is_open, a missing directory leaves it closed.
+    //      path - directory to open.
+    //
+    inline Directory(const char * path) :
+        _path(path),
+        _fd(::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) { }
+
+    // Constructor
+    //      Open a directory within another.
+    //      parent - open directory.
+    //      name   - directory in it.
+    //
+    inline Directory(const Directory& parent, const string& name) :
+        _path(parent.path(name)),
+        _fd(::openat(parent.fd(), name.c_str(),
+                     O_RDONLY | O_DIRECTORY | O_CLOEXEC)) { }
+
+    // Destructor
+    //
+    inline ~Directory() { if (0 <= _fd) ::close(_fd); }
+
+    // is_open
+    //      Return true if the directory was opened.
+    //
+    inline bool is_open() const { return (0 <= _fd); }
+
+    // fd
+    //      The directory's file descriptor, for the *at calls.
+    //
+    inline int fd() const { return _fd; }
+
+    // path
+    //      The directory's path, for messages.
+    //
+    inline const char * path() const { return _path.c_str(); }
+
+    // path
+    //      Path of a file in the directory, for messages.
+    //      name - file name.
+    //
+    inline string path(const string& name) const
+    {
+        return _path + '/' + name;
+    }
+
+    // open
+    //      Open a file in the directory.
+    //      name  - file name.
+    //      flags - ::open flags.
+    //      mode  - permissions if it's created.
+    //      returns a file descriptor, or -1.
+    //
+    inline int open(const string& name, int flags, mode_t mode = 0666) const
+    {
+        return ::openat(_fd, name.c_str(), flags | O_CLOEXEC, mode);
+    }
+
+    // exists
+    //      Return true if there's a file (or directory) by that name.
+    //
+    inline bool exists(const string& name) const
+    {
+        struct stat st;
+        return (0 == ::fstatat(_fd, name.c_str(), &st, 0));
+    }
+
+    // file_size
+    //      Size of a file in bytes, or -1 if it isn't there.
+    //
+    inline off_t file_size(const string& name) const
+    {
+        struct stat st;
+        if (0 != ::fstatat(_fd, name.c_str(), &st, 0)) return -1;
+        return st.st_size;
+    }
+
+    // make_directory
+    //      Create a directory in this one.
+    //      returns true if it's there afterward.
+    //
+    inline bool make_directory(const string& name) const
+    {
+        return (0 == ::mkdirat(_fd, name.c_str(), 0777)) ||
+               (EEXIST == errno);
+    }
+
+    // remove
+    //      Remove a file from the directory.
+    //      returns true if it was removed.
+    //
+    inline bool remove(const string& name) const
+    {
+        return (0 == ::unlinkat(_fd, name.c_str(), 0));
+    }
+
+protected:
+    // Container
+    //
+    const string _path;
+    const int    _fd;
+
+private:
+    // do not copy!
+    Directory(const Directory&);
+    Directory& operator=(const Directory&);
+};
+
+
+// InFile
+//      Input stream on a file in a Directory.
+//
+class InFile : public istream
+{
+public:
+    // Constructor
+    //      Check is_open, a missing file leaves it closed (and failed).
+    //      dir  - open directory.
+    //      name - file in it.
+    //      mode - stream mode, in is added.
+    //
+    inline InFile(const Directory&  dir,
+                  const string&     name,
+                  ios_base::openmode mode = ios_base::in) :
+        istream(0),
+        _buffer(dir.open(name, O_RDONLY), mode | ios_base::in)
+    {
+        init(&_buffer);
+        if (!is_open()) setstate(ios_base::failbit);
+    }
+
+    // is_open
+    //      Return true if the file was opened.
+    //
+    inline bool is_open() const { return _buffer.is_open(); }
+
+protected:
+    __gnu_cxx::stdio_filebuf<char> _buffer;
+};
+
+
+// OutFile
+//      Output stream on a file in a Directory. The file is created,
+//      or truncated unless the mode has app.
+//
+class OutFile : public ostream
+{
+public:
+    // Constructor
+    //      Check is_open, it's closed (and failed) if the file
+    //      can't be created.
+    //      dir  - open directory.
+    //      name - file in it.
+    //      mode - stream mode, out is added.
+    //
+    inline OutFile(const Directory&  dir,
+                   const string&     name,
+                   ios_base::openmode mode = ios_base::out) :
+        ostream(0),
+        _buffer(dir.open(name, O_WRONLY | O_CREAT |
+                         ((mode & ios_base::app) ? O_APPEND : O_TRUNC)),
+                mode | ios_base::out)
+    {
+        init(&_buffer);
+        if (!is_open()) setstate(ios_base::failbit);
+    }
+
+    // is_open
+    //      Return true if the file was opened.
+    //
+    inline bool is_open() const { return _buffer.is_open(); }
+
+protected:
+    __gnu_cxx::stdio_filebuf<char> _buffer;
+};
+
+
 #endif // DIRECTORIES_H
 
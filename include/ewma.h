@@ -0,0 +1,573 @@
+#ifndef EWMA_H
+#define EWMA_H
+
+#include "numerictypes.h"
+#include "source_data.h"
+#include "correlations.h"
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <string>
+#include <sstream>
+#include <math.h>
+
+using namespace std;
+
+//  Exponentially Weighted Moving Averages
+//      Alternative to the N-day windows. A day's weight decays by half
+//      every half-life, so a large day fades out instead of dropping
+//      off the end of a window all at once. Each symbol keeps a mean
+//      and a variance, each pair a covariance, all updated in O(1) per
+//      day without any window history:
+//          a          = 1 - 2^(-1 / half_life)
+//          delta      = x - mean
+//          mean      += a * delta
+//          variance   = (1 - a) * (variance + a * delta^2)
+//          covariance = (1 - a) * (covariance + a * dx * dy)
+//
+
+
+//  EwmaHalfLives
+//      The half-lives, in trading days, shared by every accumulator
+//      and correlator. Set once before starting threads: from the
+//      command line in preprocess, from the first file read in
+//      correlate.
+//
+class EwmaHalfLives
+{
+public:
+    //  max_count
+    //      Room for this many half-lives in each record.
+    //
+    static const int max_count = 4;
+
+    //  set
+    //      Choose the half-lives. Returns false (and changes nothing)
+    //      if there are none, too many or one is less than a day.
+    //
+    static bool set(const vector<double>& half_lives)
+    {
+        if (half_lives.empty() || (max_count < half_lives.size()))
+            return false;
+
+        for (size_t i = 0; i < half_lives.size(); ++i)
+            if (!(1.0 <= half_lives[i])) return false;
+
+        s_count = half_lives.size();
+        for (int i = 0; i < s_count; ++i)
+        {
+            s_half_life[i] = half_lives[i];
+            s_alpha[i] = 1.0 - pow(2.0, -1.0 / half_lives[i]);
+        }
+        return true;
+    }
+
+    //  parse
+    //      Set the half-lives from a comma separated list, eg. "10,50".
+    //
+    static bool parse(const string& list)
+    {
+        vector<double> half_lives;
+
+        istringstream in(list);
+        string half_life;
+        while (getline(in, half_life, ','))
+        {
+            istringstream value(half_life);
+            double h;
+            if (!(value >> h)) return false;
+            half_lives.push_back(h);
+        }
+        return set(half_lives);
+    }
+
+    //  count
+    //      Number of half-lives in use.
+    //
+    inline static int count() { return s_count; }
+
+    //  half_life
+    //  alpha
+    //      The i'th half-life and its smoothing factor.
+    //
+    inline static double half_life(int i) { return s_half_life[i]; }
+    inline static double alpha(int i) { return s_alpha[i]; }
+
+    //  warm_up
+    //      Samples needed before a mean and variance are reported.
+    //
+    inline static int warm_up(int i) { return int(ceil(s_half_life[i])); }
+
+    //  save_header
+    //      Start an EWMA file with a magic tag and the half-lives.
+    //      The records' FileHeader follows (see file_header.h).
+    //      out - stream to write to.
+    //
+    static void save_header(ostream& out)
+    {
+        out.write(s_magic.data(), s_magic.length());
+        out << IntType(s_count);
+        for (int i = 0; i < s_count; ++i)
+            out << DoubleType(s_half_life[i]);
+    }
+
+    //  load_header
+    //      Read the header of an EWMA file. Takes the half-lives from
+    //      the file if none are set yet, otherwise they have to match.
+    //      in - stream to read from.
+    //
+    static bool load_header(istream& in)
+    {
+        string magic(s_magic.length(), ' ');
+        in.read(&magic[0], magic.length());
+        if (!in.good() || (magic != s_magic)) return false;
+
+        IntType count;
+        in >> count;
+        if (!in.good() || (0 >= count) || (max_count < count)) return false;
+
+        vector<double> half_lives;
+        for (int i = 0; i < count; ++i)
+        {
+            DoubleType h;
+            in >> h;
+            half_lives.push_back(h);
+        }
+        if (!in.good()) return false;
+
+        if (0 == s_count) return set(half_lives);
+
+        if (s_count != count) return false;
+        for (int i = 0; i < s_count; ++i)
+            if (s_half_life[i] != half_lives[i]) return false;
+        return true;
+    }
+
+protected:
+    static const string s_magic;
+    static int          s_count;
+    static double       s_half_life[max_count];
+    static double       s_alpha[max_count];
+
+    // static only! do not construct!
+    EwmaHalfLives() { }
+};
+const string EwmaHalfLives::s_magic("EWMA");
+int          EwmaHalfLives::s_count(0);
+double       EwmaHalfLives::s_half_life[EwmaHalfLives::max_count];
+double       EwmaHalfLives::s_alpha[EwmaHalfLives::max_count];
+
+
+//  EwmaMoments
+//      One half-life's worth of a symbol's day.
+//      Real - some numeric type.
+//
+template<class Real>
+struct EwmaMoments
+{
+    //  mean
+    //  variance
+    //      After today's update. Invalid until warmed up.
+    //
+    Real mean;
+    Real variance;
+
+    //  delta
+    //      Today's value less yesterday's mean. Drives the
+    //      covariance updates. Invalid on days without a value.
+    //
+    Real delta;
+};
+
+
+//  EwmaStatisticalData
+//      Current value plus the moments for every half-life.
+//      Only the first EwmaHalfLives::count() moments are used.
+//
+template<class Real>
+struct EwmaStatisticalData
+{
+    //  value
+    //      Current value.
+    //
+    Real value;
+
+    //  moment
+    //      Moments in half-life order.
+    //
+    EwmaMoments<Real> moment[EwmaHalfLives::max_count];
+
+    //  is_valid
+    //      Same test as StatisticalData.
+    //
+    static bool is_valid(const EwmaStatisticalData& sd)
+    {
+        return (Real::is_valid(sd.value));
+    }
+};
+
+//  Stream I/O operators.
+//  operator<<
+//      out - output stream.
+//      sd  - EwmaStatisticalData to stream.
+//      returns - stream for continued use.
+//
+template<class Real>
+ostream& operator<< (ostream& out, const EwmaStatisticalData<Real>& sd)
+{
+    out << sd.value;
+    for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        out << sd.moment[i].mean << sd.moment[i].variance << sd.moment[i].delta;
+
+    if (!constants::save_as_binary) out << endl;
+    return out;
+}
+
+//  operator>>
+//      in - input stream.
+//      sd - EwmaStatisticalData to stream.
+//      returns - stream for continued use.
+//
+template<class Real>
+istream& operator>> (istream& in, EwmaStatisticalData<Real>& sd)
+{
+    in >> sd.value;
+    for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        in >> sd.moment[i].mean >> sd.moment[i].variance >> sd.moment[i].delta;
+    return in;
+}
+
+//  BlockCodec
+//      The value, then the mean, variance and delta of each half-life
+//      in use, so the record size depends on EwmaHalfLives::count().
+//
+template<class Real>
+struct BlockCodec< EwmaStatisticalData<Real> >
+{
+    static const bool enabled = true;
+    static const int  layout  = layout_ewma_statistical_data;
+
+    inline static int real_width() { return sizeof(Real); }
+
+    inline static size_t size()
+    {
+        return sizeof(Real) * (1 + 3 * EwmaHalfLives::count());
+    }
+
+    inline static void pack(const EwmaStatisticalData<Real>& sd, char * out)
+    {
+        memcpy(out, &(sd.value.value), sizeof(Real));
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        {
+            const EwmaMoments<Real>& m = sd.moment[i];
+            out += sizeof(Real);
+            memcpy(out, &(m.mean.value), sizeof(Real));
+            out += sizeof(Real);
+            memcpy(out, &(m.variance.value), sizeof(Real));
+            out += sizeof(Real);
+            memcpy(out, &(m.delta.value), sizeof(Real));
+        }
+    }
+
+    inline static void unpack(const char * in, EwmaStatisticalData<Real>& sd)
+    {
+        memcpy(&(sd.value.value), in, sizeof(Real));
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        {
+            EwmaMoments<Real>& m = sd.moment[i];
+            in += sizeof(Real);
+            memcpy(&(m.mean.value), in, sizeof(Real));
+            in += sizeof(Real);
+            memcpy(&(m.variance.value), in, sizeof(Real));
+            in += sizeof(Real);
+            memcpy(&(m.delta.value), in, sizeof(Real));
+        }
+    }
+};
+
+
+//  EwmaAccumulator
+//      A symbol's exponentially weighted mean and variance
+//      for every half-life.
+//
+template<class Real>
+class EwmaAccumulator
+{
+public:
+    //  Constructor
+    //
+    inline EwmaAccumulator() : _count(0) { }
+
+    //  update
+    //      Add a new value into every accumulator. An invalid value
+    //      (a day the symbol didn't trade) leaves the accumulators
+    //      alone: the moments carry over and the delta is invalid.
+    //
+    inline void update(const Real& new_value, EwmaStatisticalData<Real>& sdata)
+    {
+        sdata.value = new_value;
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+            sdata.moment[i] = EwmaMoments<Real>();
+
+        if (!Real::is_valid(new_value))
+        {
+            for (int i = 0; i < EwmaHalfLives::count(); ++i)
+            {
+                if (EwmaHalfLives::warm_up(i) < _count)
+                {
+                    sdata.moment[i].mean     = _mean[i];
+                    sdata.moment[i].variance = _variance[i];
+                }
+            }
+            return;
+        }
+
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        {
+            // The first value is the mean, with nothing to compare.
+            if (0 == _count)
+            {
+                _mean[i] = new_value;
+                _variance[i] = 0.0f;
+                continue;
+            }
+
+            double a        = EwmaHalfLives::alpha(i);
+            double delta    = double(new_value) - double(_mean[i]);
+            double variance = _variance[i];
+
+            _mean[i]     = double(_mean[i]) + a * delta;
+            _variance[i] = (1.0 - a) * (variance + a * delta * delta);
+
+            sdata.moment[i].delta = delta;
+            if (EwmaHalfLives::warm_up(i) <= _count)
+            {
+                sdata.moment[i].mean     = _mean[i];
+                sdata.moment[i].variance = _variance[i];
+            }
+        }
+        ++_count;
+    }
+
+    //  reset
+    //      Resets to completely uninitialized.
+    //
+    inline void reset() { _count = 0; }
+
+    //  count
+    //  mean
+    //  variance
+    //      Expose the state of the accumulator for checkpointing.
+    //
+    inline int& count() { return _count; }
+    inline const int& count() const { return _count; }
+    inline Real& mean(int i) { return _mean[i]; }
+    inline const Real& mean(int i) const { return _mean[i]; }
+    inline Real& variance(int i) { return _variance[i]; }
+    inline const Real& variance(int i) const { return _variance[i]; }
+
+protected:
+    //  _count
+    //      Number of valid values seen.
+    //
+    int _count;
+
+    //  _mean
+    //  _variance
+    //      One per half-life.
+    //
+    Real _mean[EwmaHalfLives::max_count];
+    Real _variance[EwmaHalfLives::max_count];
+};
+
+//  Stream I/O operators.
+//  operator<<
+//      Save the state of an accumulator: the number of values,
+//      then the mean and variance for each half-life.
+//
+template<class Real>
+ostream& operator<< (ostream& out, const EwmaAccumulator<Real>& ea)
+{
+    out << IntType(ea.count());
+    for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        out << ea.mean(i) << ea.variance(i);
+
+    if (!constants::save_as_binary) out << endl;
+    return out;
+}
+
+//  operator>>
+//      Restore the state of an accumulator.
+//
+template<class Real>
+istream& operator>> (istream& in, EwmaAccumulator<Real>& ea)
+{
+    IntType count;
+    in >> count;
+    ea.count() = count;
+    for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        in >> ea.mean(i) >> ea.variance(i);
+    return in;
+}
+
+
+//  EwmaCorrelations
+//      A pair's running covariance and today's correlation
+//      for every half-life. The covariance carries over from
+//      day to day, so a day's file is all it takes to go on.
+//
+template<class Real>
+struct EwmaCorrelations
+{
+    //  covariance
+    //      Exponentially weighted covariance. Invalid until
+    //      both symbols have traded on the same day.
+    //
+    Real covariance[EwmaHalfLives::max_count];
+
+    //  r
+    //      Correlation, in half-life order.
+    //
+    Real r[EwmaHalfLives::max_count];
+};
+
+//  Stream I/O operators.
+//
+template<class Real>
+ostream& operator<< (ostream& out, const EwmaCorrelations<Real>& c)
+{
+    for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        out << c.covariance[i] << c.r[i];
+
+    if (!constants::save_as_binary) out << endl;
+    return out;
+}
+
+template<class Real>
+istream& operator>> (istream& in, EwmaCorrelations<Real>& c)
+{
+    for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        in >> c.covariance[i] >> c.r[i];
+    return in;
+}
+
+//  BlockCodec
+//      The covariance and correlation of each half-life in use.
+//
+template<class Real>
+struct BlockCodec< EwmaCorrelations<Real> >
+{
+    static const bool enabled = true;
+    static const int  layout  = layout_ewma_correlations;
+
+    inline static int real_width() { return sizeof(Real); }
+
+    inline static size_t size()
+    {
+        return sizeof(Real) * 2 * EwmaHalfLives::count();
+    }
+
+    inline static void pack(const EwmaCorrelations<Real>& c, char * out)
+    {
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        {
+            memcpy(out, &(c.covariance[i].value), sizeof(Real));
+            out += sizeof(Real);
+            memcpy(out, &(c.r[i].value), sizeof(Real));
+            out += sizeof(Real);
+        }
+    }
+
+    inline static void unpack(const char * in, EwmaCorrelations<Real>& c)
+    {
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        {
+            memcpy(&(c.covariance[i].value), in, sizeof(Real));
+            in += sizeof(Real);
+            memcpy(&(c.r[i].value), in, sizeof(Real));
+            in += sizeof(Real);
+        }
+    }
+};
+
+
+//  EwmaCorrelator
+//      Move a pair's covariance on by a day and correlate.
+//
+template<class Real>
+class EwmaCorrelator
+{
+public:
+    typedef EwmaCorrelations<Real>    CorrelationsType;
+    typedef EwmaStatisticalData<Real> StatisticalDataType;
+
+    //  Constructor
+    //
+    inline EwmaCorrelator() { }
+
+    //  compute
+    //      The covariance only moves on days both symbols have a value
+    //      (a valid delta); the other days carry it over.
+    //      cs - the pair's state, updated in place.
+    //
+    inline void compute(CorrelationsType&           cs,
+                        const StatisticalDataType&  sd_one,
+                        const StatisticalDataType&  sd_two)
+    {
+        for (int i = 0; i < EwmaHalfLives::count(); ++i)
+        {
+            const EwmaMoments<Real>& one = sd_one.moment[i];
+            const EwmaMoments<Real>& two = sd_two.moment[i];
+
+            if (Real::is_valid(one.delta) && Real::is_valid(two.delta))
+            {
+                double a = EwmaHalfLives::alpha(i);
+                double covariance = Real::is_valid(cs.covariance[i])
+                                  ? double(cs.covariance[i]) : 0.0;
+
+                cs.covariance[i] = (1.0 - a) * (covariance +
+                    a * double(one.delta) * double(two.delta));
+            }
+
+            cs.r[i] = Real::invalid_value;
+            if (Real::is_valid(one.variance)     &&
+                Real::is_valid(two.variance)     &&
+                Real::is_valid(cs.covariance[i]) )
+            {
+                // compute the product of the two standard deviations
+                double sigmas = sqrt(double(one.variance) *
+                                     double(two.variance));
+                // The variances move on each symbol's own days and the
+                // covariance only on the days they share, so the ratio
+                // can step outside [-1, 1]; hold it there.
+                if (0.0 < sigmas)
+                    cs.r[i] = max(-1.0, min(1.0,
+                                  double(cs.covariance[i]) / sigmas));
+            }
+        }
+    }
+
+protected:
+    //  Do Not Copy
+    //
+    inline EwmaCorrelator(const EwmaCorrelator&) { }
+};
+
+
+typedef EwmaStatisticalData<FloatType> FloatEwmaStatisticalData;
+typedef EwmaAccumulator<FloatType>     FloatEwmaAccumulator;
+typedef EwmaCorrelations<FloatType>    FloatEwmaCorrelations;
+typedef EwmaCorrelator<FloatType>      FloatEwmaCorrelator;
+
+typedef ExtendedContainer< FloatEwmaStatisticalData,
+                           deque< FloatEwmaStatisticalData > >
+                         FloatEwmaStatisticalDeque;
+typedef ExtendedContainer< FloatEwmaAccumulator,
+                           deque< FloatEwmaAccumulator > >
+                         FloatEwmaAccumulatorDeque;
+
+typedef CrossCorrelation< FloatType, FloatEwmaCorrelations >
+                         FloatEwmaCrossCorrelation;
+
+
+#endif // EWMA_H
@@ -0,0 +1,144 @@
+#ifndef FILE_HEADER_H
+#define FILE_HEADER_H
+
+#include "block_codec.h"
+#include <stdint.h>
+#include <string.h>
+#include <iostream>
+
+using namespace std;
+
+//  FileHeader
+//      Fixed 32 byte header at the start of the binary record files
+//      (ticks, backgrounds, means, correlations). Records what the
+//      records are and how many there are, so a reader can check the
+//      file before trusting it and size its container once.
+//      Files from before the header don't start with the magic and
+//      are read the way they always were.
+//
+struct FileHeader
+{
+    //  current_version
+    //      Bump when the header itself changes.
+    //
+    static const uint16_t current_version = 1;
+
+    //  endian_marker
+    //      Written in native byte order.
+    //
+    static const uint32_t endian_marker = 0x01020304;
+
+    char     magic[4];
+    uint16_t version;
+    uint16_t layout;        // RecordLayout of the records.
+    uint16_t record_size;   // Bytes per record.
+    uint8_t  real_width;    // Bytes per floating point value, 0 for none.
+    uint8_t  reserved;
+    uint32_t endian;        // endian_marker.
+    uint32_t symbol_count;  // Symbols covered, 0 if it doesn't apply.
+    int32_t  date;          // Date index, -1 if not a single day.
+    uint64_t count;         // Number of records.
+
+    //  describe
+    //      Header for a file of count T records.
+    //      symbols - number of symbols covered.
+    //      date    - date index of the data.
+    //      encoded - the records are stored as encoded blocks.
+    //
+    template<class T>
+    static FileHeader describe(uint64_t count,
+                               uint32_t symbols = 0,
+                               int32_t  date = -1,
+                               bool     encoded = false)
+    {
+        typedef BlockCodec<T> Codec;
+
+        FileHeader h;
+        memcpy(h.magic, s_magic, sizeof(h.magic));
+        h.version      = current_version;
+        h.layout       = Codec::layout | (encoded ? layout_encoded : 0);
+        h.record_size  = Codec::size();
+        h.real_width   = Codec::real_width();
+        h.reserved     = 0;
+        h.endian       = endian_marker;
+        h.symbol_count = symbols;
+        h.date         = date;
+        h.count        = count;
+        return h;
+    }
+
+    //  matches
+    //      Return true if the file holds T records this build can read.
+    //      encoded - check for the encoded form of the records.
+    //
+    template<class T>
+    bool matches(bool encoded = false) const
+    {
+        typedef BlockCodec<T> Codec;
+
+        return ((current_version >= version)         &&
+                ((Codec::layout | (encoded ? layout_encoded : 0)) ==
+                     layout)                         &&
+                (Codec::size() == record_size)       &&
+                (Codec::real_width() == real_width)  &&
+                (endian_marker == endian)            );
+    }
+
+    //  is_encoded
+    //      Return true if the records are stored as encoded blocks.
+    //
+    bool is_encoded() const { return (0 != (layout & layout_encoded)); }
+
+    //  save
+    //      Write the header to a binary stream.
+    //
+    void save(ostream& out) const
+    {
+        out.write((const char *)(this), sizeof(FileHeader));
+    }
+
+    //  load
+    //      Read a header if the stream starts with one.
+    //      Otherwise rewind, it's a file from before the header.
+    //      returns true if there was a header.
+    //
+    bool load(istream& in)
+    {
+        streampos start = in.tellg();
+
+        in.read((char *)(this), sizeof(FileHeader));
+        if (in.good() && (0 == memcmp(magic, s_magic, sizeof(magic))))
+            return true;
+
+        in.clear();
+        in.seekg(start);
+        return false;
+    }
+
+    //  load
+    //      Read a header from the start of a buffer.
+    //      bytes  - start of the file.
+    //      length - bytes available.
+    //      returns true if there was a header.
+    //
+    bool load(const char * bytes, size_t length)
+    {
+        if (sizeof(FileHeader) > length) return false;
+
+        memcpy((void *)(this), bytes, sizeof(FileHeader));
+        return (0 == memcmp(magic, s_magic, sizeof(magic)));
+    }
+
+protected:
+    //  s_magic
+    //      Read as the first int or float of an old file this is an
+    //      impossible date index, correlation or delta.
+    //
+    static const char s_magic[4];
+};
+const char FileHeader::s_magic[4] = { '\x89', 'C', 'R', 'L' };
+
+static_assert(32 == sizeof(FileHeader), "FileHeader must stay 32 bytes");
+
+
+#endif // FILE_HEADER_H
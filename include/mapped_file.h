@@ -0,0 +1,132 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <string>
+#include <string_view>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "directories.h"
+
+using namespace std;
+
+//  MappedFile
+//      Read only view of a whole file through mmap.
+//      An empty file opens fine and has no text.
+//
+class MappedFile
+{
+public:
+    //  Constructor
+    //
+    inline MappedFile() : _base(0), _size(0), _open(false) { }
+
+    //  Construct and map a file.
+    //      filename - file to map.
+    //
+    inline MappedFile(const char * filename) :
+        _base(0), _size(0), _open(false)
+    {
+        open(filename);
+    }
+
+    //  Construct and map a file in a directory.
+    //      dir  - open directory.
+    //      name - file in it.
+    //
+    inline MappedFile(const Directory& dir, const string& name) :
+        _base(0), _size(0), _open(false)
+    {
+        open(dir, name);
+    }
+
+    //  Destructor
+    //
+    inline ~MappedFile() { close(); }
+
+    //  open
+    //      Map a file.
+    //      returns true if it's mapped.
+    //
+    inline bool open(const char * filename)
+    {
+        return map_file(::open(filename, O_RDONLY | O_CLOEXEC));
+    }
+
+    inline bool open(const Directory& dir, const string& name)
+    {
+        return map_file(dir.open(name, O_RDONLY));
+    }
+
+    //  close
+    //      Unmap the file.
+    //
+    void close()
+    {
+        if (0 != _base) ::munmap((void *)(_base), _size);
+        _base = 0;
+        _size = 0;
+        _open = false;
+    }
+
+    //  is_open
+    //      Return true if a file is mapped.
+    //
+    inline bool is_open() const { return _open; }
+
+    //  text
+    //      The whole file.
+    //
+    inline string_view text() const { return string_view(_base, _size); }
+
+protected:
+    //  map_file
+    //      Map an open file read ahead sequentially, and close
+    //      the descriptor.
+    //      fd - file descriptor, or -1.
+    //
+    bool map_file(int fd)
+    {
+        close();
+        if (0 > fd) return false;
+
+        struct stat st;
+        if (0 == ::fstat(fd, &st))
+        {
+            if (0 == st.st_size)
+                _open = true;
+            else
+            {
+                void * base = ::mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (MAP_FAILED != base)
+                {
+                    ::madvise(base, st.st_size, MADV_SEQUENTIAL);
+                    _base = (const char *)(base);
+                    _size = st.st_size;
+                    _open = true;
+                }
+            }
+        }
+        ::close(fd);
+
+        return _open;
+    }
+
+    //  _base
+    //  _size
+    //  _open
+    //      The mapping.
+    //
+    const char * _base;
+    size_t       _size;
+    bool         _open;
+
+private:
+    //  Do Not Copy
+    //
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+};
+
+#endif // MAPPED_FILE_H
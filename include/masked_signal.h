@@ -0,0 +1,332 @@
+#ifndef MASKED_SIGNAL_H
+#define MASKED_SIGNAL_H
+
+#include "signals.h"
+#include "batched_accumulator.h"
+#include <stdint.h>
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+//  MaskedSignal
+//      Samples as plain floats, with which of them are there in a
+//      separate packed bitmap, instead of a NaN in each missing one.
+//      A missing sample holds 0, so sums over the samples need no
+//      test at all, and anything that does need to know (a count, a
+//      pairing with another signal) works on 64 samples a word.
+//
+struct MaskedSignal
+{
+    //  value
+    //  valid
+    //      The samples, and bit i of the bitmap set if sample i is
+    //      there.
+    //
+    vector<float>    value;
+    vector<uint64_t> valid;
+
+    //  Constructors
+    //      Every sample missing.
+    //      samples - number of samples.
+    //
+    inline MaskedSignal() { }
+    inline explicit MaskedSignal(size_t samples) { resize(samples); }
+
+    //  resize
+    //      Size to some samples, every one missing.
+    //
+    void resize(size_t samples)
+    {
+        value.assign(samples, 0.0f);
+        valid.assign((samples + 63) / 64, 0);
+    }
+
+    //  size
+    //      Number of samples.
+    //
+    inline size_t size() const { return value.size(); }
+
+    //  is_valid
+    //      Return true if sample i is there.
+    //
+    inline bool is_valid(size_t i) const
+    {
+        return (0 != (valid[i / 64] & (uint64_t(1) << (i % 64))));
+    }
+
+    //  set
+    //      Set sample i. A NaN leaves it missing.
+    //
+    inline void set(size_t i, float v)
+    {
+        bool there = !isnan(v);
+        value[i] = there ? v : 0.0f;
+        valid[i / 64] |= uint64_t(there) << (i % 64);
+    }
+
+    //  add
+    //      Add to sample i. Adding a NaN adds nothing, as with
+    //      RealType's +=.
+    //
+    inline void add(size_t i, float v)
+    {
+        bool there = !isnan(v);
+        value[i] += there ? v : 0.0f;
+        valid[i / 64] |= uint64_t(there) << (i % 64);
+    }
+
+    //  operator+=
+    //      Add another signal of the same size, sample by sample.
+    //      A sample is there if it was in either.
+    //
+    MaskedSignal& operator+=(const MaskedSignal& x)
+    {
+        for (size_t i = 0; i < value.size(); ++i) value[i] += x.value[i];
+        for (size_t w = 0; w < valid.size(); ++w) valid[w] |= x.valid[w];
+        return *this;
+    }
+
+    //  assign
+    //      Copy a signal of NaN's for missing samples.
+    //
+    template<class Real>
+    void assign(const Signal< RealType<Real> >& signal)
+    {
+        resize(signal.sample.size());
+        for (size_t i = 0; i < signal.sample.size(); ++i)
+            set(i, signal.sample[i].value);
+    }
+
+    //  copy_to
+    //      Copy into a signal of NaN's for missing samples.
+    //
+    template<class Real>
+    void copy_to(Signal< RealType<Real> >& signal) const
+    {
+        signal.sample.assign(value.size(), RealType<Real>());
+        for (size_t i = 0; i < value.size(); ++i)
+            if (is_valid(i)) signal.sample[i] = value[i];
+    }
+};
+
+
+//  Masked reductions
+//      Sums over the samples of a run of floats that a bitmap says are
+//      there, FloatLanes::width at a time, the bits turned straight
+//      into a lane mask. Whatever is in the other samples, NaN
+//      included, never gets in. The lanes are summed separately, then
+//      together, so results can differ from a plain loop in the last
+//      bits.
+//      x, y  - the floats, from bit 0 of valid.
+//      valid - bitmap.
+//      n     - number of samples.
+//
+
+//  lane_bits
+//      The bits of the FloatLanes::width samples from i, a multiple of
+//      the width.
+//
+inline uint32_t lane_bits(const uint64_t * valid, size_t i)
+{
+    return uint32_t(valid[i / 64] >> (i % 64)) &
+           uint32_t((uint64_t(1) << FloatLanes::width) - 1);
+}
+
+//  masked_count
+//      Number of bits set in the first n of a bitmap, or of two
+//      bitmaps and'ed together.
+//
+inline size_t masked_count(const uint64_t * valid, size_t n)
+{
+    size_t count = 0;
+    for (size_t w = 0; w < n / 64; ++w)
+        count += __builtin_popcountll(valid[w]);
+    if (0 != n % 64)
+        count += __builtin_popcountll(valid[n / 64] &
+                                      ((uint64_t(1) << (n % 64)) - 1));
+    return count;
+}
+
+inline size_t masked_count(const uint64_t * a, const uint64_t * b, size_t n)
+{
+    size_t count = 0;
+    for (size_t w = 0; w < n / 64; ++w)
+        count += __builtin_popcountll(a[w] & b[w]);
+    if (0 != n % 64)
+        count += __builtin_popcountll(a[n / 64] & b[n / 64] &
+                                      ((uint64_t(1) << (n % 64)) - 1));
+    return count;
+}
+
+//  MaskedValue
+//  MaskedSquare
+//  MaskedProduct
+//      What masked_reduce adds up for one sample.
+//
+struct MaskedValue
+{
+    static inline FloatLanes::Vector term(FloatLanes::Vector x, FloatLanes::Vector)
+    {
+        return x;
+    }
+    static inline float term(float x, float) { return x; }
+};
+
+struct MaskedSquare
+{
+    static inline FloatLanes::Vector term(FloatLanes::Vector x, FloatLanes::Vector)
+    {
+        return FloatLanes::mul(x, x);
+    }
+    static inline float term(float x, float) { return x * x; }
+};
+
+struct MaskedProduct
+{
+    static inline FloatLanes::Vector term(FloatLanes::Vector x, FloatLanes::Vector y)
+    {
+        return FloatLanes::mul(x, y);
+    }
+    static inline float term(float x, float y) { return x * y; }
+};
+
+//  masked_reduce
+//      Sum a term (MaskedValue, ...) over the samples that are there.
+//
+template<class Term>
+float masked_reduce(const float * x, const float * y,
+                    const uint64_t * valid, size_t n)
+{
+    typedef FloatLanes Lanes;
+    const int W = Lanes::width;
+
+    const typename Lanes::Vector zero = Lanes::set1(0.0f);
+    typename Lanes::Vector sum = zero;
+
+    size_t i = 0;
+    for (; i + W <= n; i += W)
+    {
+        typename Lanes::Mask m = Lanes::from_bits(lane_bits(valid, i));
+        sum = Lanes::add(sum,
+                         Lanes::select(m, Term::term(Lanes::loadu(x + i),
+                                                     Lanes::loadu(y + i)),
+                                       zero));
+    }
+
+    float lanes[W] __attribute__((aligned(64)));
+    Lanes::store(lanes, sum);
+
+    float total = 0.0f;
+    for (int lane = 0; lane < W; ++lane) total += lanes[lane];
+
+    for (; i < n; ++i)
+    {
+        bool there = (0 != (valid[i / 64] & (uint64_t(1) << (i % 64))));
+        total += there ? Term::term(x[i], y[i]) : 0.0f;
+    }
+    return total;
+}
+
+//  masked_sum
+//  masked_sum_of_squares
+//  masked_dot
+//
+inline float masked_sum(const float * x, const uint64_t * valid, size_t n)
+{
+    return masked_reduce<MaskedValue>(x, x, valid, n);
+}
+
+inline float masked_sum_of_squares(const float * x, const uint64_t * valid, size_t n)
+{
+    return masked_reduce<MaskedSquare>(x, x, valid, n);
+}
+
+inline float masked_dot(const float * x, const float * y,
+                        const uint64_t * valid, size_t n)
+{
+    return masked_reduce<MaskedProduct>(x, y, valid, n);
+}
+
+//  MaskedMoments
+//      What a correlation needs of the samples two runs share: how
+//      many, and their sums, sums of squares and sum of products.
+//
+struct MaskedMoments
+{
+    float count;
+    float x;
+    float y;
+    float xx;
+    float yy;
+    float xy;
+};
+
+//  masked_moments
+//      All of MaskedMoments in one pass, for a pair of runs whose
+//      shared samples are the bits of valid.
+//
+inline void masked_moments(const float * x, const float * y,
+                           const uint64_t * valid, size_t n,
+                           MaskedMoments& m)
+{
+    typedef FloatLanes Lanes;
+    const int W = Lanes::width;
+
+    const Lanes::Vector zero = Lanes::set1(0.0f);
+    Lanes::Vector sx = zero, sy = zero, sxx = zero, syy = zero, sxy = zero;
+
+    size_t i = 0;
+    for (; i + W <= n; i += W)
+    {
+        Lanes::Mask   b  = Lanes::from_bits(lane_bits(valid, i));
+        Lanes::Vector vx = Lanes::select(b, Lanes::loadu(x + i), zero);
+        Lanes::Vector vy = Lanes::select(b, Lanes::loadu(y + i), zero);
+
+        sx  = Lanes::add(sx, vx);
+        sy  = Lanes::add(sy, vy);
+        sxx = Lanes::add(sxx, Lanes::mul(vx, vx));
+        syy = Lanes::add(syy, Lanes::mul(vy, vy));
+        sxy = Lanes::add(sxy, Lanes::mul(vx, vy));
+    }
+
+    float lanes[5][W] __attribute__((aligned(64)));
+    Lanes::store(lanes[0], sx);
+    Lanes::store(lanes[1], sy);
+    Lanes::store(lanes[2], sxx);
+    Lanes::store(lanes[3], syy);
+    Lanes::store(lanes[4], sxy);
+
+    m.x = m.y = m.xx = m.yy = m.xy = 0.0f;
+    for (int lane = 0; lane < W; ++lane)
+    {
+        m.x  += lanes[0][lane];
+        m.y  += lanes[1][lane];
+        m.xx += lanes[2][lane];
+        m.yy += lanes[3][lane];
+        m.xy += lanes[4][lane];
+    }
+
+    for (; i < n; ++i)
+    {
+        if (0 == (valid[i / 64] & (uint64_t(1) << (i % 64)))) continue;
+
+        m.x  += x[i];
+        m.y  += y[i];
+        m.xx += x[i] * x[i];
+        m.yy += y[i] * y[i];
+        m.xy += x[i] * y[i];
+    }
+    m.count = float(masked_count(valid, n));
+}
+
+//  masked_sum
+//      Sum of the samples of a signal that are there.
+//
+inline float masked_sum(const MaskedSignal& s)
+{
+    return s.value.empty() ? 0.0f
+                           : masked_sum(&s.value[0], &s.valid[0], s.size());
+}
+
+#endif // MASKED_SIGNAL_H
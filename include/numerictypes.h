@@ -3,9 +3,9 @@
 
 #include <math.h>
 #include <boost/operators.hpp>
-#include <boost/numeric/conversion/converter.hpp>
 #include <limits>
 #include "constants.h"
+#include "block_codec.h"
 
 using namespace std;
 
@@ -199,6 +199,30 @@ istream& operator>> (istream& in, RealType<T>& t)
     return in;
 }
 
+//  BlockCodec
+//      The file record is the bare value.
+//
+template< class T >
+struct BlockCodec< RealType<T> >
+{
+    static const bool enabled = true;
+    static const int  layout  = layout_real;
+
+    inline static int real_width() { return sizeof(T); }
+
+    inline static size_t size() { return sizeof(T); }
+
+    inline static void pack(const RealType<T>& t, char * out)
+    {
+        memcpy(out, &(t.value), sizeof(T));
+    }
+
+    inline static void unpack(const char * in, RealType<T>& t)
+    {
+        memcpy(&(t.value), in, sizeof(T));
+    }
+};
+
 //  Default TypeDefs for float and double (not used).
 //
 typedef RealType<float> FloatType;
@@ -372,6 +396,30 @@ istream& operator>> (istream& in, IntegerType<T>& t)
     return in;
 }
 
+//  BlockCodec
+//      The file record is the bare value.
+//
+template< class T >
+struct BlockCodec< IntegerType<T> >
+{
+    static const bool enabled = true;
+    static const int  layout  = layout_integer;
+
+    inline static int real_width() { return 0; }
+
+    inline static size_t size() { return sizeof(T); }
+
+    inline static void pack(const IntegerType<T>& t, char * out)
+    {
+        memcpy(out, &(t.value), sizeof(T));
+    }
+
+    inline static void unpack(const char * in, IntegerType<T>& t)
+    {
+        memcpy(&(t.value), in, sizeof(T));
+    }
+};
+
 //  Default TypeDef for long and int.
 //
 typedef IntegerType<int>  IntType;
@@ -379,6 +427,41 @@ typedef IntegerType<long> LongType;
 
 //  Type Conversion
 //
+//  ConversionError
+//      Why a number didn't convert.
+//
+enum ConversionError
+{
+    conversion_ok = 0,
+    conversion_invalid,     // NaN in.
+    conversion_overflow     // doesn't fit.
+};
+
+//  checked_float_to_int
+//      Convert a floating point number to an integer, rounding half
+//      to even, without exceptions. Out of range and NaN both fail
+//      the range test, so the only branch is picking the error.
+//      fin  - input floating point number.
+//      iout - rounded integer value, or -1 if it didn't convert.
+//      returns conversion_ok or why not.
+//
+template< class F, class I >
+inline ConversionError checked_float_to_int(F fin, I& iout)
+{
+    // (the default rounding mode is to nearest, half to even.)
+    F rounded = nearbyint(fin);
+
+    // -min is a power of two, so it's exact in F.
+    bool fits = (rounded >= F(IntegerType<I>::Limits::min())) &
+                (rounded <  -F(IntegerType<I>::Limits::min()));
+
+    I converted = I(fits ? rounded : F(0));
+    iout = fits ? converted : IntegerType<I>::invalid_value;
+
+    if (fits) return conversion_ok;
+    return isnan(fin) ? conversion_invalid : conversion_overflow;
+}
+
 //  float_type_to_int_type
 //      Convert a floating point number to an integer, rounding.
 //      NaN's will be converted to -1's.
@@ -386,35 +469,24 @@ typedef IntegerType<long> LongType;
 //      returns rounded integer value or -1 for invalid input.
 //
 template< class F, class I >
-I float_type_to_int_type(F fin)
+inline I float_type_to_int_type(F fin)
 {
-    if (RealType<F>::is_invalid(fin))    
-        return IntegerType<I>::invalid_value;
-    
-    using namespace boost::numeric;
-    typedef converter< I,
-                       F,
-                       conversion_traits< I, F >,
-                       def_overflow_handler,
-                       RoundEven< F >,
-                       raw_converter< conversion_traits< I, F > >,
-                       UseInternalRangeChecker > FtoI;
-
-    FtoI convert;
-    I result = IntegerType< I >::invalid_value;
-
-    try
-    {
-        result = convert(fin);
-    }
-    catch(exception&)
-    {
-        result = IntegerType< I >::invalid_value;
-    }
-    
+    I result;
+    checked_float_to_int(fin, result);
     return result;
 }
 
+//  dollars_to_pennies
+//      Convert a price to pennies, as a Tick holds it.
+//      dollars - price.
+//      pennies - rounded pennies, or -1 if it didn't convert.
+//      returns conversion_ok or why not.
+//
+inline ConversionError dollars_to_pennies(float dollars, long& pennies)
+{
+    return checked_float_to_int<float, long>(float(dollars * 100.0), pennies);
+}
+
 
 //  Random Helper Functions
 //
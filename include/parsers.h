@@ -2,11 +2,17 @@
 #define PARSERS_H
 
 #include <string>
+#include <string_view>
+#include <charconv>
+#include <system_error>
 #include <vector>
 #include <fstream>
 #include <boost/algorithm/string.hpp>
 #include <boost/foreach.hpp>
 #include <boost/lexical_cast.hpp>
+#include "directories.h"
+#include "mapped_file.h"
+#include "csv_scanner.h"
 
 
 using namespace std;
@@ -45,10 +51,58 @@ private:
 };
 
 
+// FieldError
+//      Why a field didn't read as a number.
+//
+enum FieldError
+{
+    field_ok = 0,
+    field_empty,
+    field_malformed,        // not all of it is a number.
+    field_out_of_range
+};
+
+// parse_field
+//      Read a whole field as a number with from_chars: no copies,
+//      exceptions or locale. Takes what lexical_cast takes, a leading
+//      '+' included.
+//      field - the text.
+//      value - set to the number, left alone if it isn't one.
+//      returns field_ok, or why not.
+//
+template<class T>
+inline FieldError parse_field(string_view field, T& value)
+{
+    if (field.empty()) return field_empty;
+
+    const char * first = field.data();
+    const char * last  = first + field.size();
+    if ('+' == *first)
+    {
+        ++first;
+        if ((last == first) || ('-' == *first)) return field_malformed;
+    }
+
+    T parsed;
+    from_chars_result r = from_chars(first, last, parsed);
+    if (errc::result_out_of_range == r.ec) return field_out_of_range;
+    if ((errc() != r.ec) || (last != r.ptr)) return field_malformed;
+
+    value = parsed;
+    return field_ok;
+}
+
+
 // handy type to simplify calls...
 
 typedef vector<string> stringvector;
 
+// fieldvector
+//      Fields of a line as views into the line.
+//      Only good until the next line is parsed.
+//
+typedef vector<string_view> fieldvector;
+
 
 // sample_rule
 //      Sample Rule Predicate for generating a vector
@@ -169,6 +223,20 @@ public:
     //      delims   - delimiters for each line (',' for CSV files, etc.)
     //
     inline FileParser(const char * filename, const char * delims) :
+         _dir(0),
+         _filename(filename),
+         _delims(delims) {}
+
+    // FileParser
+    //      Constructor
+    //      dir      - open directory the file is in.
+    //      filename - file to parse in it.
+    //      delims   - delimiters for each line (',' for CSV files, etc.)
+    //
+    inline FileParser(const Directory& dir,
+                      const string&    filename,
+                      const char *     delims) :
+         _dir(&dir),
          _filename(filename),
          _delims(delims) {}
          
@@ -183,7 +251,26 @@ public:
     template<class Rules, class Container>
     inline bool load_using(Rules& r, Container& c)
     {
+        if (0 != _dir)
+        {
+            InFile source(*_dir, _filename);
+            return load_using(source, r, c);
+        }
+
         ifstream source(_filename.c_str());
+        return load_using(source, r, c);
+    }
+    
+protected:
+    // load_using
+    //      Parse an open file.
+    //      source - the file.
+    //      r      - predicate function for parsing a line.
+    //      c      - container for parsed data.
+    //
+    template<class Rules, class Container>
+    inline bool load_using(istream& source, Rules& r, Container& c)
+    {
         if(source.fail())
         {
             printf("Error failed to open file: %s\n", _filename.c_str());
@@ -200,20 +287,193 @@ public:
             getline(source, line);
             if (!line.empty()) lp.parse(line, r, c);
         }
-        source.close();
         return true;
     }
+
+    const Directory * _dir;
+    string _filename;
+    string _delims;
+
+private:
+    // No default constructor!
+    inline FileParser() {}
     
+    // Do not copy!
+    inline FileParser(const FileParser&) {}
+};
+
+
+// FieldParser
+//      Split a line into views of its fields. Same fields as
+//      LineParser: a field starting with a quote runs on, over any
+//      delimiters, to the first delimiter (or end of line) after a
+//      quote, and keeps its quotes. A quoted field that never
+//      closes is dropped. Nothing is copied, and the field vector
+//      is reused from line to line.
+//
+class FieldParser
+{
+public:
+    // FieldParser
+    //      Constructor
+    //      delims   - delimiters for each line (',' for CSV files, etc.)
+    //
+    inline FieldParser(const char * delims) : _delims(delims) { }
+
+    // parse
+    //      Split a line and parse it given rules.
+    //      line - the line, without its newline.
+    //      r    - predicate function for parsing a line:
+    //             void r(const fieldvector& elements, Container& c)
+    //      c    - container for parsed data.
+    //
+    template<class Rules, class Container>
+    inline void parse(string_view line, Rules& r, Container& c)
+    {
+        _elements.clear();
+
+        size_t begin = 0;
+        while (true)
+        {
+            size_t end = line.find_first_of(_delims, begin);
+            if (string_view::npos == end) end = line.size();
+
+            if ((begin < line.size()) && ('"' == line[begin]))
+            {
+                // Run on to the first piece that ends with a quote.
+                while ((line.size() > end) && ('"' != line[end - 1]))
+                {
+                    end = line.find_first_of(_delims, end + 1);
+                    if (string_view::npos == end) end = line.size();
+                }
+
+                // Still open at the end of the line.
+                if ('"' != line[end - 1]) break;
+            }
+
+            _elements.push_back(line.substr(begin, end - begin));
+
+            if (line.size() <= end) break;
+            begin = end + 1;
+        }
+
+        r(_elements, c);
+    }
+
+protected:
+    // delimiters and the reused field vector.
+    string_view _delims;
+    fieldvector _elements;
+
+private:
+    // no default constructor!
+    inline FieldParser() {}
+
+    // do not copy!
+    inline FieldParser(const FieldParser&) {}
+};
+
+
+// ScannedLineParser
+//      Visitor for a StructuralScanner: the fields of plain lines go
+//      straight to the rules, quoted lines are split again by a
+//      FieldParser.
+//
+template<class Rules, class Container>
+class ScannedLineParser
+{
+public:
+    inline ScannedLineParser(const char * delims, Rules& r, Container& c) :
+        _fp(delims), _r(r), _c(c) { }
+
+    inline void operator()(string_view         line,
+                           const fieldvector& fields,
+                           bool                quoted)
+    {
+        if (quoted) _fp.parse(line, _r, _c);
+        else        _r(fields, _c);
+    }
+
+protected:
+    FieldParser _fp;
+    Rules&      _r;
+    Container&  _c;
+};
+
+
+// MappedFileParser
+//      FileParser for the big files: maps the file and hands the
+//      rules views of the fields (see FieldParser) instead of
+//      copies. Rules take a fieldvector rather than a stringvector.
+//      Lines and fields are found by a StructuralScanner.
+//
+class MappedFileParser
+{
+public:
+    // MappedFileParser
+    //      Constructor
+    //      filename - file to parse.
+    //      delims   - delimiters for each line (',' for CSV files, etc.)
+    //
+    inline MappedFileParser(const char * filename, const char * delims) :
+         _dir(0),
+         _filename(filename),
+         _delims(delims) {}
+
+    // MappedFileParser
+    //      Constructor
+    //      dir      - open directory the file is in.
+    //      filename - file to parse in it.
+    //      delims   - delimiters for each line (',' for CSV files, etc.)
+    //
+    inline MappedFileParser(const Directory& dir,
+                            const string&    filename,
+                            const char *     delims) :
+         _dir(&dir),
+         _filename(filename),
+         _delims(delims) {}
+
+    // load_using
+    //      Map the file and parse every line after the header.
+    //      r - predicate function for parsing a line.
+    //      c - container for parsed data.
+    //
+    template<class Rules, class Container>
+    inline bool load_using(Rules& r, Container& c)
+    {
+        MappedFile source;
+        if (0 != _dir) source.open(*_dir, _filename);
+        else           source.open(_filename.c_str());
+
+        if (!source.is_open())
+        {
+            printf("Error failed to open file: %s\n", _filename.c_str());
+            return false;
+        }
+
+        string_view text = source.text();
+
+        // skip past the header.
+        size_t begin = text.find('\n');
+        if (string_view::npos == begin) return true;
+
+        StructuralScanner<> scanner(_delims.c_str());
+        ScannedLineParser<Rules, Container> lines(_delims.c_str(), r, c);
+        scanner.scan(text.substr(begin + 1), lines);
+        return true;
+    }
+
 protected:
+    const Directory * _dir;
     string _filename;
     string _delims;
 
 private:
     // No default constructor!
-    inline FileParser() {}
+    inline MappedFileParser() {}
     
     // Do not copy!
-    inline FileParser(const FileParser& fp) {}
+    inline MappedFileParser(const MappedFileParser&) {}
 };
 
 
@@ -1,14 +1,16 @@
 #ifndef PROGRESS_BAR
 #define PROGRESS_BAR
 
-#include "semaphore.h"
+#include <boost/thread.hpp>
+#include <string>
 #include <stdio.h>
 
 //  ProgressBar
 //      Contain the logic for outputting a progress bar.
 //      Progress bar is divided into sixtyfourths to 
 //      fit on a terminal window (and for easy arithmetic.
-//      Thread-safe.
+//      Thread-safe. Each bar keeps its own count, so several
+//      can be counting at once (only one should be shown).
 //
 class ProgressBar
 {
@@ -16,17 +18,16 @@ public:
     //  Constructor
     //      Default constructor.
     //
-    inline ProgressBar() : _sixtyfourth(0) {}
+    inline ProgressBar() : _sixtyfourth(0), _count(0), _shown(true) {}
 
     //  Constructor
     //      message - What does the progress represent?
     //      length  - Count of things to progress through.
     //
-    ProgressBar(const char * message, unsigned int length) : _banner(message), _sixtyfourth(length)
+    ProgressBar(const char * message, unsigned int length) :
+        _sixtyfourth(0), _count(0), _shown(true)
     {
-        _sixtyfourth >>= 6;
-        if (0 == _sixtyfourth) _sixtyfourth = 1;
-        PBSem::reset(*this);
+        reset(message, length);
     }
 
     //  Destructor
@@ -34,7 +35,7 @@ public:
     //
     ~ProgressBar()
     {
-        if (0 != _sixtyfourth)
+        if (_shown && (0 != _sixtyfourth))
             ::printf("\n"); // sometimes two characters...
     }
 
@@ -45,25 +46,53 @@ public:
     //
     void reset(const char * message, unsigned int length)
     {
+        boost::lock_guard<boost::mutex> lock(_count_mutex);
         _banner = message;
 
         _sixtyfourth = length;
         _sixtyfourth >>= 6;
         if (0 == _sixtyfourth) _sixtyfourth = 1;
-        PBSem::reset(*this);
+        _count = 0;
+
+        if (_shown)
+        {
+            ::printf("\n\n%s\n"\
+//  64-character progress bar.
+// 01234567890123456789012345678901234567890123456789012345678901234
+  "|-------|-------|-------|-------|-------|-------|-------|--------|\n ",
+                     _banner.c_str());
+        }
     }        
 
+    //  hide
+    //      Count without drawing anything, for a bar that's
+    //      running alongside others.
+    //
+    inline void hide() { _shown = false; }
+
     //  count
     //      Expose the current count.
     //
-    inline const int count() const { return PBSem::count(); }
+    inline const int count() const
+    {
+        boost::lock_guard<boost::mutex> lock(_count_mutex);
+        return _count;
+    }
 
     //  increment
     //      Increment the internal counter.
     //      Output a '-' if the counter gets past a sixtyfourth of lentgh.    
     void increment()
     {
-        PBSem::increment(*this);
+        boost::lock_guard<boost::mutex> lock(_count_mutex);
+        ++_count;
+
+        if (!_shown || (0 == _sixtyfourth)) return;
+        if (0 == (_count % _sixtyfourth))
+        {
+            ::putchar('-');
+            ::fflush(stdout);
+        }
     }
 
 protected:
@@ -77,37 +106,23 @@ protected:
     //
     string _banner;
 
-    //  PBSem
-    //      Semaphore class for actually updating the progress bar.
+    //  _count
+    //  _count_mutex
+    //      The current count and a mutex to lock access to it.
     //
-    friend class Semaphore< ProgressBar, ProgressBar, ProgressBar >;
-    typedef Semaphore< ProgressBar, ProgressBar, ProgressBar > PBSem;
-    
-    //  operator()()
-    //      This is the action to take on reset.
+    int                  _count;
+    mutable boost::mutex _count_mutex;
+
+    //  _shown
+    //      Draw the bar?
     //
-    void operator()()
-    {
-        ::printf("\n\n%s\n"\
-//  64-character progress bar.
-// 01234567890123456789012345678901234567890123456789012345678901234
-  "|-------|-------|-------|-------|-------|-------|-------|--------|\n ",
-                 _banner.c_str());
-    }
+    bool _shown;
 
-    //  operator()(int)
-    //      This is the action to take on increment (or decrement - not used).
-    //      count - the current count.
+private:
+    //  Do Not Copy
     //
-    void operator()(int count)
-    {
-        if (0 == _sixtyfourth) return;
-        if (0 == (count % _sixtyfourth))
-        {
-            ::putchar('-');
-            ::fflush(stdout);
-        }
-    }
+    ProgressBar(const ProgressBar&);
+    ProgressBar& operator=(const ProgressBar&);
 };
 
 #endif //PROGRESS_BAR
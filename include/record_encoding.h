@@ -0,0 +1,264 @@
+#ifndef RECORD_ENCODING_H
+#define RECORD_ENCODING_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <iostream>
+#include <iterator>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+//  Encoded records
+//      A compact binary form for records made of a few slowly
+//      changing integers (ticks: a date index and a close in pennies).
+//      Each record is split into integer columns. The records are
+//      written a block at a time; within a block each column is
+//      stored as the zigzag varint of its change from the previous
+//      record, one column after the other, so decoding a block is a
+//      few tight loops over a byte buffer. Every block starts from
+//      zero and can be decoded on its own.
+//
+//      Block on disk:
+//          uint32 records
+//          uint32 bytes    - bytes of column data that follow.
+//          column 0 varints, column 1 varints, ...
+//
+
+//  RecordEncoding
+//      Describe how to split a type into integer columns.
+//      Specialize next to the type's stream operators.
+//      enabled - false here: the type has no encoded form.
+//
+//      A specialization provides:
+//          static const int columns;
+//          static void split(const T& t, int64_t * column);
+//          static void join(const int64_t * column, T& t);
+//
+template<class T>
+struct RecordEncoding
+{
+    static const bool enabled = false;
+};
+
+//  encoded_block_records
+//      Records per encoded block.
+//
+const size_t encoded_block_records = 1 << 14;
+
+//  zigzag
+//  unzigzag
+//      Map signed values onto unsigned ones so that small changes
+//      either way encode in few bytes.
+//
+inline uint64_t zigzag(int64_t v)
+{
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t u)
+{
+    return int64_t(u >> 1) ^ -int64_t(u & 1);
+}
+
+//  put_varint
+//      Append 7 bits at a time, low bits first, high bit set on all
+//      but the last byte.
+//
+inline void put_varint(vector<char>& out, uint64_t u)
+{
+    while (0x80 <= u)
+    {
+        out.push_back(char(uint8_t(u) | 0x80));
+        u >>= 7;
+    }
+    out.push_back(char(u));
+}
+
+//  get_varint
+//      Decode a varint.
+//      p   - current position, moved past the varint.
+//      end - end of the buffer.
+//      returns false if the buffer ends inside the varint.
+//
+inline bool get_varint(const uint8_t *& p, const uint8_t * end, uint64_t& u)
+{
+    // Most changes fit in one byte.
+    if ((p < end) && (0 == (*p & 0x80)))
+    {
+        u = *p++;
+        return true;
+    }
+
+    u = 0;
+    for (int shift = 0; (p < end) && (64 > shift); shift += 7)
+    {
+        uint8_t b = *p++;
+        u |= uint64_t(b & 0x7f) << shift;
+        if (0 == (b & 0x80)) return true;
+    }
+    return false;
+}
+
+//  encode_block
+//      Encode records [first, first + count) into a block.
+//      first  - iterator to the first record.
+//      count  - number of records.
+//      block  - cleared and filled with the block, including its header.
+//
+template<class Iterator>
+void encode_block(Iterator first, size_t count, vector<char>& block)
+{
+    typedef typename iterator_traits<Iterator>::value_type T;
+    typedef RecordEncoding<T>                              Encoding;
+
+    block.clear();
+    block.resize(2 * sizeof(uint32_t));
+
+    vector<int64_t> column(count * Encoding::columns);
+    Iterator it = first;
+    for (size_t i = 0; i < count; ++i, ++it)
+        Encoding::split(*it, &column[i * Encoding::columns]);
+
+    for (int c = 0; c < Encoding::columns; ++c)
+    {
+        int64_t previous = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            int64_t v = column[i * Encoding::columns + c];
+            put_varint(block, zigzag(v - previous));
+            previous = v;
+        }
+    }
+
+    uint32_t header[2] = { uint32_t(count),
+                           uint32_t(block.size() - sizeof(header)) };
+    memcpy(&block[0], header, sizeof(header));
+}
+
+//  decode_block
+//      Decode the column data of a block.
+//      data    - column data (after the block header).
+//      bytes   - size of the column data.
+//      count   - records in the block.
+//      first   - where to put them.
+//      returns false if the data is short.
+//
+template<class Iterator>
+bool decode_block(const char * data, size_t bytes, size_t count, Iterator first)
+{
+    typedef typename iterator_traits<Iterator>::value_type T;
+    typedef RecordEncoding<T>                              Encoding;
+
+    const uint8_t * p   = (const uint8_t *)(data);
+    const uint8_t * end = p + bytes;
+
+    vector<int64_t> column(count * Encoding::columns);
+    for (int c = 0; c < Encoding::columns; ++c)
+    {
+        int64_t  value = 0;
+        int64_t* out   = &column[c];
+        for (size_t i = 0; i < count; ++i, out += Encoding::columns)
+        {
+            uint64_t u;
+            if (!get_varint(p, end, u)) return false;
+            value += unzigzag(u);
+            *out = value;
+        }
+    }
+
+    Iterator it = first;
+    for (size_t i = 0; i < count; ++i, ++it)
+        Encoding::join(&column[i * Encoding::columns], *it);
+
+    return true;
+}
+
+//  save_encoded_to
+//      Write the records of a container as encoded blocks.
+//      c       - container for the data.
+//      outfile - binary stream to write to.
+//
+template<class STL_Container>
+void save_encoded_to(const STL_Container& c, ostream& outfile)
+{
+    vector<char> block;
+
+    typename STL_Container::const_iterator it = c.begin();
+    size_t done = 0;
+    while (done < c.size())
+    {
+        size_t records = min(c.size() - done, encoded_block_records);
+        encode_block(it, records, block);
+        outfile.write(&block[0], block.size());
+
+        advance(it, records);
+        done += records;
+    }
+}
+
+//  load_encoded_from
+//      Read encoded blocks to the end of the stream.
+//      c        - container for the data, sized once from expected.
+//      iFile    - binary stream to read from (must be seekable).
+//      expected - record count from the file header. Every record
+//                 takes at least a byte per column, so a count the
+//                 rest of the file can't hold is cut down to what it
+//                 can before the container is sized.
+//      A damaged block ends the load; the records before it are kept.
+//      Block lengths and counts are checked against the bytes left
+//      before anything is sized from them.
+//
+template<class STL_Container>
+void load_encoded_from(STL_Container& c, istream& iFile, uint64_t expected)
+{
+    typedef RecordEncoding<typename STL_Container::value_type> Encoding;
+
+    if (!c.empty()) c.clear();
+
+    streampos begin = iFile.tellg();
+    iFile.seekg(0, ios_base::end);
+    streampos end = iFile.tellg();
+    iFile.seekg(begin);
+    if ((0 > begin) || (end < begin) || !iFile.good()) return;
+
+    uint64_t left = uint64_t(end - begin);
+    uint64_t most = left / Encoding::columns;
+    if (most < expected) expected = most;
+    c.resize(expected);
+
+    vector<char> buffer;
+    typename STL_Container::iterator it = c.begin();
+    size_t done = 0;
+    while (done < expected)
+    {
+        uint32_t header[2];
+        if (sizeof(header) > left) break;
+        iFile.read((char *)(header), sizeof(header));
+        left -= sizeof(header);
+        if (!iFile.good()                                  ||
+            (0 == header[0])                               ||
+            (encoded_block_records < header[0])            ||
+            (expected - done < header[0])                  ||
+            (left < header[1])                             ||
+            (uint64_t(header[0]) * Encoding::columns > header[1]) ) break;
+        left -= header[1];
+
+        buffer.resize(header[1]);
+        iFile.read(buffer.data(), header[1]);
+        if (size_t(iFile.gcount()) != header[1]) break;
+
+        if (!decode_block(buffer.data(), header[1], header[0], it)) break;
+
+        advance(it, header[0]);
+        done += header[0];
+    }
+
+    // Short or damaged file - keep what made it.
+    if (done < expected) c.resize(done);
+}
+
+
+#endif // RECORD_ENCODING_H
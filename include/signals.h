@@ -3,6 +3,7 @@
 
 #include "extended_container.h"
 #include "date_index.h"
+#include "trading_calendar.h"
 #include "numerictypes.h"
 #include "container_io.h"
 #include <vector>
@@ -47,6 +48,20 @@ struct Signal
     //      Default value is used to skip the entry on save.
     //
     inline Signal() : sample(DateIndex::interval()) { }
+
+    //  compact
+    //      Keep just the samples of the trading days of a calendar, so
+    //      sample[t] is trading day t rather than a date index. Only
+    //      the date indexed form can be saved, loaded or compacted.
+    //      calendar - built from the data.
+    //
+    void compact(const TradingCalendar& calendar)
+    {
+        SampleSet days(calendar.size());
+        for (TradingCalendar::DayType t = 0; t < calendar.size(); ++t)
+            days[t] = sample[calendar.date(t)];
+        sample.swap(days);
+    }
     
     //  Serialization
     //
@@ -70,6 +85,24 @@ struct Signal
         ::save_to(record, filename);
     }
 
+    //  save_to
+    //      Save to a file in a directory. Skips invalid samples.
+    //      dir  - open directory.
+    //      name - file in it.
+    //
+    void save_to(const Directory& dir, const string& name)
+    {
+        Recording record;
+        
+        for(int i = 0; i < DateIndex::interval(); i++)
+        {
+            if (T::is_valid(sample[i]))
+                record.push_back(RecordType(i, sample[i]));
+        }
+        
+        ::save_to(record, dir, name);
+    }
+
     //  load_from
     //      Load from a text file using STL fstreams.
     //      filename - source file.
@@ -84,6 +117,22 @@ struct Signal
             sample[r.index] = r.value;
         }
     }
+
+    //  load_from
+    //      Load from a file in a directory.
+    //      dir  - open directory.
+    //      name - file in it.
+    //
+    void load_from(const Directory& dir, const string& name)
+    {
+        Recording record;
+        ::load_from(record, dir, name);
+        
+        BOOST_FOREACH(RecordType r, record)
+        {
+            sample[r.index] = r.value;
+        }
+    }
 };
 
 typedef Signal<IntType>     IntSignal;
@@ -57,6 +57,20 @@ struct NDayType
         root_mean_square(r.root_mean_square)
     { }
 
+    //  operator=()
+    //      r - copied Residuals.
+    //
+    inline NDayType& operator=(const NDayType& r)
+    {
+        if (&r != this)
+        {
+            mean = r.mean;
+            residual = r.residual;
+            root_mean_square = r.root_mean_square;
+        }
+        return *this;
+    }
+
     //  clear
     //      Assign invalid values to the containers.
     //
@@ -118,6 +132,43 @@ istream& operator>> (istream& in, NDayType<Real, N>& nd)
     return in;
 }
 
+//  BlockCodec
+//      The mean, the N residuals, then the root mean square.
+//
+template<class Real, int N>
+struct BlockCodec< NDayType<Real, N> >
+{
+    static const bool enabled = true;
+    static const int  layout  = layout_n_day;
+
+    inline static int real_width() { return sizeof(Real); }
+
+    inline static size_t size() { return NDayType<Real, N>::Size(); }
+
+    //  The residuals are copied as one run of values, through
+    //  Real::value rather than the class itself.
+    //
+    static_assert(sizeof(Real) == sizeof(Real::value),
+                  "a Real is stored as its value");
+
+    inline static void pack(const NDayType<Real, N>& nd, char * out)
+    {
+        memcpy(out, &(nd.mean.value), sizeof(Real));
+        memcpy(out + sizeof(Real), &(nd.residual[0].value), N * sizeof(Real));
+        memcpy(out + (N + 1) * sizeof(Real), &(nd.root_mean_square.value),
+               sizeof(Real));
+    }
+
+    inline static void unpack(const char * in, NDayType<Real, N>& nd)
+    {
+        nd.residual.resize(N);
+        memcpy(&(nd.mean.value), in, sizeof(Real));
+        memcpy(&(nd.residual[0].value), in + sizeof(Real), N * sizeof(Real));
+        memcpy(&(nd.root_mean_square.value), in + (N + 1) * sizeof(Real),
+               sizeof(Real));
+    }
+};
+
 
 //  StatisticalData
 //      Contain the 10- and 50-day moving averages.
@@ -178,6 +229,20 @@ struct StatisticalData
         fifty_day(r.fifty_day)
     { }
 
+    //  operator=()
+    //      r - copied data.
+    //
+    inline StatisticalData& operator=(const StatisticalData& r)
+    {
+        if (&r != this)
+        {
+            value = r.value;
+            ten_day = r.ten_day;
+            fifty_day = r.fifty_day;
+        }
+        return *this;
+    }
+
     //  is_valid
     //      Return true always. Makes a set of data that
     //      matches the ticks in length and indexing.
@@ -228,6 +293,37 @@ istream& operator>> (istream& in, StatisticalData<Real>& sd)
     return in;
 }
 
+//  BlockCodec
+//      The value, then the 50-day data, then the 10-day data.
+//
+template<class Real>
+struct BlockCodec< StatisticalData<Real> >
+{
+    typedef BlockCodec< typename StatisticalData<Real>::FiftydMAType > Fifty;
+    typedef BlockCodec< typename StatisticalData<Real>::TendMAType >   Ten;
+
+    static const bool enabled = true;
+    static const int  layout  = layout_statistical_data;
+
+    inline static int real_width() { return sizeof(Real); }
+
+    inline static size_t size() { return StatisticalData<Real>::Size(); }
+
+    inline static void pack(const StatisticalData<Real>& sd, char * out)
+    {
+        memcpy(out, &(sd.value.value), sizeof(Real));
+        Fifty::pack(sd.fifty_day, out + sizeof(Real));
+        Ten::pack(sd.ten_day, out + sizeof(Real) + Fifty::size());
+    }
+
+    inline static void unpack(const char * in, StatisticalData<Real>& sd)
+    {
+        memcpy(&(sd.value.value), in, sizeof(Real));
+        Fifty::unpack(in + sizeof(Real), sd.fifty_day);
+        Ten::unpack(in + sizeof(Real) + Fifty::size(), sd.ten_day);
+    }
+};
+
 typedef StatisticalData<FloatType>  FloatStatisticalData;
 typedef StatisticalData<DoubleType> DoubleStatisticalData;
 
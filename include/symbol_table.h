@@ -0,0 +1,150 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#include <stdint.h>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+//  SymbolId
+//      Dense id of an interned symbol: 0, 1, 2... in the order they
+//      were first seen.
+//
+typedef uint32_t SymbolId;
+const SymbolId no_symbol = 0xffffffff;
+
+//  SymbolTable
+//      Intern ticker symbols. Every name is kept once, back to back
+//      in one arena, and found again through an open addressed hash
+//      table of ids, so symbols can be carried and compared as ids
+//      instead of strings.
+//
+class SymbolTable
+{
+public:
+    //  Constructor
+    //
+    inline SymbolTable() : _offsets(1, 0), _slots(s_min_slots, no_symbol) { }
+
+    //  intern
+    //      Id of a symbol, adding it if it's new.
+    //      symbol - the name.
+    //      returns its id; size() - 1 if it was just added.
+    //
+    SymbolId intern(string_view symbol)
+    {
+        size_t slot = find_slot(symbol);
+        if (no_symbol != _slots[slot]) return _slots[slot];
+
+        SymbolId id = SymbolId(size());
+        _arena.append(symbol.data(), symbol.size());
+        _offsets.push_back(uint32_t(_arena.size()));
+        _slots[slot] = id;
+
+        // keep the table at most half full.
+        if (_slots.size() < 2 * size()) grow();
+        return id;
+    }
+
+    //  find
+    //      Id of a symbol, or no_symbol.
+    //
+    inline SymbolId find(string_view symbol) const
+    {
+        return _slots[find_slot(symbol)];
+    }
+
+    //  name
+    //      Name of an id. Good until the next intern.
+    //
+    inline string_view name(SymbolId id) const
+    {
+        return string_view(_arena.data() + _offsets[id],
+                           _offsets[id + 1] - _offsets[id]);
+    }
+
+    //  size
+    //      Number of symbols.
+    //
+    inline size_t size() const { return _offsets.size() - 1; }
+
+    //  reserve
+    //      Room for some symbols of some total length.
+    //
+    void reserve(size_t symbols, size_t characters)
+    {
+        _arena.reserve(characters);
+        _offsets.reserve(symbols + 1);
+        while (_slots.size() < 2 * symbols) grow();
+    }
+
+    //  clear
+    //
+    void clear()
+    {
+        _arena.clear();
+        _offsets.assign(1, 0);
+        _slots.assign(s_min_slots, no_symbol);
+    }
+
+protected:
+    static const size_t s_min_slots = 16;
+
+    //  hash
+    //      FNV-1a.
+    //
+    inline static uint64_t hash(string_view symbol)
+    {
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < symbol.size(); ++i)
+        {
+            h ^= (unsigned char)(symbol[i]);
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+
+    //  find_slot
+    //      Slot holding a symbol, or the empty slot it would go in.
+    //
+    inline size_t find_slot(string_view symbol) const
+    {
+        size_t mask = _slots.size() - 1;
+        size_t slot = size_t(hash(symbol)) & mask;
+        while ((no_symbol != _slots[slot]) && (name(_slots[slot]) != symbol))
+            slot = (slot + 1) & mask;
+        return slot;
+    }
+
+    //  grow
+    //      Double the hash table and put the ids back in it.
+    //
+    void grow()
+    {
+        _slots.assign(2 * _slots.size(), no_symbol);
+        size_t mask = _slots.size() - 1;
+        for (SymbolId id = 0; id < size(); ++id)
+        {
+            size_t slot = size_t(hash(name(id))) & mask;
+            while (no_symbol != _slots[slot]) slot = (slot + 1) & mask;
+            _slots[slot] = id;
+        }
+    }
+
+    //  _arena
+    //  _offsets
+    //      The names back to back, and where each starts (and the
+    //      last ends).
+    //
+    string           _arena;
+    vector<uint32_t> _offsets;
+
+    //  _slots
+    //      Ids by hash, a power of two of them.
+    //
+    vector<SymbolId> _slots;
+};
+
+#endif // SYMBOL_TABLE_H
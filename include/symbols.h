@@ -4,6 +4,8 @@
 #include <string>
 #include <stdio.h>
 #include "extended_container.h"
+#include "directories.h"
+#include "symbol_table.h"
 
 using namespace std;
 
@@ -171,6 +173,24 @@ typedef ExtendedContainer<SymbolDescriptor,
                           deque< SymbolDescriptor > > SymbolDescriptorDeque;
 
 
+//  remove_duplicate_symbols
+//      Keep the first descriptor of each symbol, in the order they
+//      came, and drop the rest. Each symbol is hashed once instead of
+//      sorting the whole list to find them.
+//      symbols - descriptors from the lists.
+//
+void remove_duplicate_symbols(SymbolDescriptorSet& symbols)
+{
+    SymbolTable seen;
+    symbols.remove_if([&seen](const SymbolDescriptor& sd)
+    {
+        size_t before = seen.size();
+        seen.intern(sd.Symbol);
+        return before == seen.size();
+    });
+}
+
+
 // For testing purposes, here's a SymbolDescriptorAction
 // to print out all of the Symbol descriptors.
 //
@@ -212,6 +232,60 @@ void load_symbols_from(SymbolVector& symbols, const char * filename)
     }
 }
 
+//  load_symbols_from
+//      symbols - SymbolVector to fill from a file in a directory.
+//      dir     - open directory.
+//      name    - file in it.
+//
+void load_symbols_from(SymbolVector& symbols, const Directory& dir,
+                       const string& name)
+{
+    if (!symbols.empty()) symbols.clear();
+    
+    InFile iFile(dir, name);
+    while (iFile.is_open() && !iFile.eof())
+    {
+        string temp;
+        if(readstring(iFile, temp))
+            symbols.push_back(temp);
+    }
+}
+
+//  load_symbols_from
+//      symbols - SymbolTable to fill from a file in a directory, one
+//                symbol a line; the id of a symbol is its line.
+//                A missing file leaves it empty.
+//      dir     - open directory.
+//      name    - file in it.
+//
+void load_symbols_from(SymbolTable& symbols, const Directory& dir,
+                       const string& name)
+{
+    symbols.clear();
+
+    InFile iFile(dir, name);
+    while (iFile.is_open() && !iFile.eof())
+    {
+        string temp;
+        if(readstring(iFile, temp) && !temp.empty())
+            symbols.intern(temp);
+    }
+}
+
+//  save_symbols_to
+//      Save a SymbolTable into a text file in a directory, in id order.
+//      symbols - the table.
+//      dir     - open directory.
+//      name    - file in it.
+//
+void save_symbols_to(const SymbolTable& symbols, const Directory& dir,
+                     const string& name)
+{
+    OutFile outfile(dir, name);
+    for (SymbolId id = 0; id < symbols.size(); ++id)
+        outfile << symbols.name(id) << endl;
+}
+
 //  save_to
 //      Save the contents of a SymbolVector into a text file. One element per "line."
 //      symbols  - container for the data.
@@ -0,0 +1,479 @@
+#ifndef TICK_STORE_H
+#define TICK_STORE_H
+
+#include "tickers.h"
+#include "symbols.h"
+#include "symbol_table.h"
+#include "trading_calendar.h"
+#include "file_header.h"
+#include <stdint.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+//  Tick Store
+//      All of the closes in one file, a symbols x days matrix, so
+//      preprocess maps one file instead of opening one per symbol.
+//      Written by getdata next to the per-symbol tick files.
+//
+//      File layout (sections start on 64 byte boundaries):
+//          FileHeader          - layout_tick_store, count = symbols x days.
+//          TickStoreLayout     - days, start date and section offsets.
+//          symbol table        - name_width bytes per symbol, NUL padded.
+//                                The row of a symbol is its symbol id.
+//          closes              - int64 pennies, one row of days per symbol.
+//          validity bitmap     - one row of 64 bit words per symbol,
+//                                bit d set if day d has a close.
+//
+
+//  TickStoreLayout
+//      Follows the FileHeader.
+//
+struct TickStoreLayout
+{
+    uint32_t days;          // Columns, DateIndex::interval() when written.
+    uint32_t name_width;    // Bytes per symbol table entry.
+    int64_t  start_day;     // Julian day of date index 0.
+    uint64_t names;         // File offsets of the sections.
+    uint64_t closes;
+    uint64_t valid;
+    uint64_t end;           // File size.
+
+    //  words
+    //      64 bit words per bitmap row.
+    //
+    inline uint32_t words() const { return (days + 63) / 64; }
+};
+
+//  Tick store constants
+//      Symbol table entry size, section alignment.
+//
+const uint32_t tick_store_name_width = 16;
+const uint64_t tick_store_alignment  = 64;
+
+//  tick_store_align
+//      Round an offset up to the section alignment.
+//
+inline uint64_t tick_store_align(uint64_t offset)
+{
+    return (offset + tick_store_alignment - 1) & ~(tick_store_alignment - 1);
+}
+
+
+//  TickStoreWriter
+//      Collect the closes of each symbol, then write the store
+//      in symbol list order.
+//
+class TickStoreWriter
+{
+public:
+    //  add
+    //      Record the ticks of a symbol.
+    //      symbol - ticker symbol.
+    //      ticks  - its date indexed closes.
+    //
+    void add(const string& symbol, const TickerSet& ticks)
+    {
+        SymbolId id = _ids.intern(symbol);
+        if (_rows.size() <= id) _rows.resize(id + 1);
+
+        vector<int64_t>& row = _rows[id];
+        row.assign(DateIndex::interval(), LongType::invalid_value);
+
+        BOOST_FOREACH(const Ticker& t, ticks)
+        {
+            if ((0 <= t.index) && (DateIndex::interval() > t.index))
+                row[t.index] = t.value.CloseNoBkg.value;
+        }
+    }
+
+    //  save
+    //      Write the store.
+    //      symbols  - the final list; one row per symbol, in order.
+    //                 Symbols that weren't added get an empty row.
+    //      filename - store file.
+    //      returns true if written.
+    //
+    bool save(const SymbolDescriptorSet& symbols, const char * filename)
+    {
+        ofstream out(filename, ios_base::out | ios_base::binary);
+        if (!out.is_open()) return false;
+
+        return save(symbols, out);
+    }
+
+    //  save
+    //      Write the store into a directory.
+    //      symbols - the final list.
+    //      dir     - open directory.
+    //      name    - store file in it.
+    //      returns true if written.
+    //
+    bool save(const SymbolDescriptorSet& symbols,
+              const Directory&           dir,
+              const string&              name)
+    {
+        OutFile out(dir, name, ios_base::out | ios_base::binary);
+        if (!out.is_open()) return false;
+
+        return save(symbols, out);
+    }
+
+    //  save
+    //      Write the store to an open stream (at its start).
+    //
+    bool save(const SymbolDescriptorSet& symbols, ostream& out)
+    {
+        TickStoreLayout layout;
+        memset(&layout, 0, sizeof(layout));
+        layout.days       = DateIndex::interval();
+        layout.name_width = tick_store_name_width;
+        layout.start_day  = constants::start_date.julian_day();
+        layout.names      = tick_store_align(sizeof(FileHeader) +
+                                             sizeof(TickStoreLayout));
+        layout.closes     = tick_store_align(layout.names +
+                                uint64_t(symbols.size()) * layout.name_width);
+        layout.valid      = tick_store_align(layout.closes +
+                                uint64_t(symbols.size()) * layout.days *
+                                sizeof(int64_t));
+        layout.end        = layout.valid + uint64_t(symbols.size()) *
+                                layout.words() * sizeof(uint64_t);
+
+        FileHeader header = FileHeader::describe<LongType>(
+            uint64_t(symbols.size()) * layout.days, symbols.size());
+        header.layout = layout_tick_store;
+        header.save(out);
+        out.write((const char *)(&layout), sizeof(layout));
+
+        // Symbol table.
+        pad_to(out, layout.names);
+        vector<char> name(layout.name_width);
+        BOOST_FOREACH(const SymbolDescriptor& sd, symbols)
+        {
+            fill(name.begin(), name.end(), '\0');
+            memcpy(&name[0], sd.Symbol.data(),
+                   min(sd.Symbol.length(), size_t(layout.name_width - 1)));
+            out.write(&name[0], name.size());
+        }
+
+        // Closes, a row per symbol.
+        pad_to(out, layout.closes);
+        vector<int64_t> empty(layout.days, LongType::invalid_value);
+        BOOST_FOREACH(const SymbolDescriptor& sd, symbols)
+        {
+            const vector<int64_t>& row = find_row(sd.Symbol, empty);
+            out.write((const char *)(&row[0]), row.size() * sizeof(int64_t));
+        }
+
+        // Validity bitmap, a row per symbol.
+        pad_to(out, layout.valid);
+        vector<uint64_t> bits(layout.words());
+        BOOST_FOREACH(const SymbolDescriptor& sd, symbols)
+        {
+            const vector<int64_t>& row = find_row(sd.Symbol, empty);
+            fill(bits.begin(), bits.end(), 0);
+            for (uint32_t d = 0; d < layout.days; ++d)
+                if (LongType::is_valid(row[d]))
+                    bits[d / 64] |= uint64_t(1) << (d % 64);
+            out.write((const char *)(&bits[0]), bits.size() * sizeof(uint64_t));
+        }
+
+        return out.good();
+    }
+
+protected:
+    //  find_row
+    //      Closes of a symbol, or the empty row.
+    //
+    const vector<int64_t>& find_row(const string& symbol,
+                                    const vector<int64_t>& empty) const
+    {
+        SymbolId id = _ids.find(symbol);
+        return (no_symbol == id) ? empty : _rows[id];
+    }
+
+    //  pad_to
+    //      Zero fill up to the start of a section.
+    //
+    static void pad_to(ostream& out, uint64_t offset)
+    {
+        static const char zeros[tick_store_alignment] = { 0 };
+        uint64_t at = uint64_t(out.tellp());
+        if (at < offset) out.write(zeros, offset - at);
+    }
+
+    //  _ids
+    //  _rows
+    //      Closes by symbol id.
+    //
+    SymbolTable             _ids;
+    vector<vector<int64_t> > _rows;
+};
+
+
+//  TickStore
+//      Read only view of a store file through mmap.
+//
+class TickStore
+{
+public:
+    //  Constructor
+    //
+    inline TickStore() : _base(0), _size(0) { }
+
+    //  Destructor
+    //
+    inline ~TickStore() { close(); }
+
+    //  open
+    //      Map a store file.
+    //      filename - store file.
+    //      returns false if it's missing, damaged, or was written for
+    //      another date range.
+    //
+    bool open(const char * filename)
+    {
+        return map_file(::open(filename, O_RDONLY));
+    }
+
+    //  open
+    //      Map a store file in a directory.
+    //      dir  - open directory.
+    //      name - store file in it.
+    //
+    bool open(const Directory& dir, const string& name)
+    {
+        return map_file(dir.open(name, O_RDONLY));
+    }
+
+    //  close
+    //      Unmap the file.
+    //
+    void close()
+    {
+        if (0 != _base) ::munmap((void *)(_base), _size);
+        _base = 0;
+        _size = 0;
+        _ids.clear();
+        _rows.clear();
+    }
+
+    //  is_open
+    //      Return true if a store is mapped.
+    //
+    inline bool is_open() const { return (0 != _base); }
+
+    //  symbols
+    //  days
+    //      Dimensions of the matrix.
+    //
+    inline int symbols() const { return int(header().symbol_count); }
+    inline int days() const    { return int(layout().days); }
+
+    //  symbol
+    //      Name of a symbol id.
+    //
+    inline string symbol(int id) const
+    {
+        const char * name = _base + layout().names +
+                            uint64_t(id) * layout().name_width;
+        return string(name, strnlen(name, layout().name_width));
+    }
+
+    //  find
+    //      Symbol id of a symbol or -1.
+    //
+    inline int find(string_view symbol) const
+    {
+        SymbolId id = _ids.find(symbol);
+        return (no_symbol == id) ? -1 : _rows[id];
+    }
+
+    //  closes
+    //      Row of closes (pennies) for a symbol id.
+    //
+    inline const int64_t * closes(int id) const
+    {
+        return (const int64_t *)(_base + layout().closes) +
+               uint64_t(id) * layout().days;
+    }
+
+    //  valid
+    //      Row of the validity bitmap for a symbol id.
+    //
+    inline const uint64_t * valid(int id) const
+    {
+        return (const uint64_t *)(_base + layout().valid) +
+               uint64_t(id) * layout().words();
+    }
+
+    //  is_valid
+    //      Return true if a symbol has a close on a day.
+    //
+    inline bool is_valid(int id, int day) const
+    {
+        return (0 != (valid(id)[day / 64] & (uint64_t(1) << (day % 64))));
+    }
+
+    //  load
+    //      Fill a signal with a symbol's closes.
+    //      id     - symbol id.
+    //      signal - destination, one sample per day.
+    //
+    void load(int id, TickerSignal& signal) const
+    {
+        const int64_t * row = closes(id);
+        for (int d = 0; d < days(); ++d)
+            signal.sample[d].CloseNoBkg = is_valid(id, d)
+                ? long(row[d]) : long(LongType::invalid_value);
+    }
+
+    //  count_days
+    //      Count each close of some symbols in a calendar.
+    //      ids      - symbol ids.
+    //      calendar - to build once everything is counted.
+    //
+    void count_days(const vector<int>& ids, TradingCalendar& calendar) const
+    {
+        BOOST_FOREACH(int id, ids)
+        {
+            const uint64_t * bits = valid(id);
+            for (uint32_t w = 0; w < layout().words(); ++w)
+            {
+                for (uint64_t word = bits[w]; 0 != word; word &= word - 1)
+                    calendar.add(int(w * 64 + __builtin_ctzll(word)));
+            }
+        }
+    }
+
+    //  load
+    //      Fill a signal with a symbol's closes on the trading days
+    //      of a calendar (see Signal::compact).
+    //      id       - symbol id.
+    //      signal   - destination, one sample per trading day.
+    //      calendar - built from the store.
+    //
+    void load(int id, TickerSignal& signal, const TradingCalendar& calendar) const
+    {
+        const int64_t * row = closes(id);
+        signal.sample.resize(calendar.size());
+        for (TradingCalendar::DayType t = 0; t < calendar.size(); ++t)
+        {
+            int d = calendar.date(t);
+            signal.sample[t].CloseNoBkg = is_valid(id, d)
+                ? long(row[d]) : long(LongType::invalid_value);
+        }
+    }
+
+protected:
+    //  map_file
+    //      Map an open store file and close the descriptor.
+    //      fd - file descriptor, or -1.
+    //
+    bool map_file(int fd)
+    {
+        close();
+
+        if (0 > fd) return false;
+
+        struct stat st;
+        if ((0 == ::fstat(fd, &st)) &&
+            (off_t(sizeof(FileHeader) + sizeof(TickStoreLayout)) <= st.st_size))
+        {
+            void * base = ::mmap(0, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+            if (MAP_FAILED != base)
+            {
+                _base = (const char *)(base);
+                _size = st.st_size;
+            }
+        }
+        ::close(fd);
+
+        if ((0 == _base) || !check())
+        {
+            close();
+            return false;
+        }
+
+        // Symbol ids by name; the last of a repeated name wins.
+        _ids.reserve(symbols(), size_t(symbols()) * 8);
+        _rows.reserve(symbols());
+        for (int id = 0; id < symbols(); ++id)
+        {
+            SymbolId interned = _ids.intern(symbol(id));
+            if (_rows.size() <= interned) _rows.push_back(id);
+            else                          _rows[interned] = id;
+        }
+
+        return true;
+    }
+
+    inline const FileHeader& header() const
+    {
+        return *(const FileHeader *)(_base);
+    }
+
+    inline const TickStoreLayout& layout() const
+    {
+        return *(const TickStoreLayout *)(_base + sizeof(FileHeader));
+    }
+
+    //  check
+    //      Make sure the mapped file is a whole store for this build,
+    //      with every section (the symbol table included) inside it.
+    //
+    bool check() const
+    {
+        FileHeader h;
+        if (!h.load(_base, _size))                          return false;
+        if ((FileHeader::current_version < h.version) ||
+            (layout_tick_store != h.layout)             ||
+            (FileHeader::endian_marker != h.endian)     )  return false;
+
+        const TickStoreLayout& l = layout();
+        return ((uint32_t(DateIndex::interval()) == l.days)             &&
+                (constants::start_date.julian_day() == l.start_day)     &&
+                (uint64_t(h.symbol_count) * l.days == h.count)          &&
+                (l.end <= _size)                                        &&
+                (0 < l.name_width)                                      &&
+                (sizeof(FileHeader) + sizeof(TickStoreLayout) <=
+                     l.names)                                           &&
+                (l.names <= l.closes)                                   &&
+                (uint64_t(h.symbol_count) * l.name_width <=
+                     l.closes - l.names)                                &&
+                (l.closes + uint64_t(h.symbol_count) * l.days *
+                     sizeof(int64_t) <= l.valid)                        &&
+                (l.valid + uint64_t(h.symbol_count) * l.words() *
+                     sizeof(uint64_t) <= l.end)                         );
+    }
+
+    //  _base
+    //  _size
+    //      The mapping.
+    //
+    const char *    _base;
+    size_t          _size;
+
+    //  _ids
+    //  _rows
+    //      Interned names, and the row of each.
+    //
+    SymbolTable _ids;
+    vector<int> _rows;
+
+private:
+    //  Do Not Copy
+    //
+    TickStore(const TickStore&);
+    TickStore& operator=(const TickStore&);
+};
+
+
+#endif // TICK_STORE_H
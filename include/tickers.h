@@ -54,7 +54,7 @@ struct Tick
     //      t - Previous ticker (n-1).
     //      Returns inverse delta close or invalid value.
     //
-    inline FloatType inverse_delta_close(const Tick& t)
+    inline FloatType inverse_delta_close(const Tick& t) const
     {
         if(LongType::is_valid(t.CloseNoBkg) && 
           (LongType::is_valid(CloseNoBkg))  &&
@@ -128,6 +128,12 @@ istream& operator>> (istream& in, Tick& t)
     return in;
 }
 
+//  BlockCodec
+//      Ticks are stored as is.
+//
+template<>
+struct BlockCodec<Tick> : public DirectBlockCodec<Tick, layout_tick> { };
+
 
 // Ticker
 //   Each set of values is indexed by date. The point in time is days from a
@@ -135,6 +141,29 @@ istream& operator>> (istream& in, Tick& t)
 //
 typedef DateIndexedType<Tick> Ticker;
 
+//  RecordEncoding
+//      Tick files are encoded as two columns, the date index and the
+//      close in pennies. Both barely change from one tick to the next.
+//
+template<>
+struct RecordEncoding<Ticker>
+{
+    static const bool enabled = true;
+    static const int  columns = 2;
+
+    inline static void split(const Ticker& t, int64_t * column)
+    {
+        column[0] = t.index;
+        column[1] = t.value.CloseNoBkg.value;
+    }
+
+    inline static void join(const int64_t * column, Ticker& t)
+    {
+        t.index                  = DateIndex::IndexType(column[0]);
+        t.value.CloseNoBkg.value = long(column[1]);
+    }
+};
+
 
 // TickerSet
 //   Contain a set of tickers.
@@ -143,7 +172,9 @@ typedef ExtendedContainer< Ticker, deque< Ticker > > TickerSet;
 
 
 //  BufferedTickerReader
-//      Read a particular tick out of a file.
+//      Read a particular tick out of a file. The tick files getdata
+//      writes are encoded, so these are decoded whole on open; only
+//      raw tick files get the block cache.
 //
 typedef BufferedRecordReader< Ticker > BufferedTickerReader;
 
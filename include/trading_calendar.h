@@ -0,0 +1,118 @@
+#ifndef TRADING_CALENDAR_H
+#define TRADING_CALENDAR_H
+
+#include "date_index.h"
+#include <vector>
+
+using namespace std;
+
+//  TradingCalendar
+//      The dates something traded on, numbered 0, 1, 2... in order.
+//      A date index counts every calendar day from the start date,
+//      weekends and holidays included, so about a third of a date
+//      indexed array is never filled in. Arrays indexed by trading
+//      day (see Signal::compact) leave those out, and loops over them
+//      don't visit days with nothing to do.
+//
+//      Count the samples of each date with add, then build:
+//          TradingCalendar calendar;
+//          for each sample: calendar.add(date);
+//          calendar.build();
+//
+class TradingCalendar
+{
+public:
+    //  DayType
+    //      Trading day index.
+    //
+    typedef int DayType;
+
+    //  Constructor
+    //      No trading days.
+    //
+    inline TradingCalendar() : _count(DateIndex::interval(), 0) { }
+
+    //  add
+    //      Count a sample on a date. Dates out of range are ignored.
+    //      date - date index.
+    //
+    inline void add(DateIndex::IndexType date)
+    {
+        if ((0 <= date) && (DateIndex::interval() > date)) ++_count[date];
+    }
+
+    //  build
+    //      Number the dates with a sample.
+    //
+    void build()
+    {
+        _date.clear();
+        _day.assign(DateIndex::interval(), -1);
+        for (DateIndex::IndexType date = 0; date < DateIndex::interval(); ++date)
+        {
+            if (0 == _count[date]) continue;
+
+            _day[date] = DayType(_date.size());
+            _date.push_back(date);
+        }
+    }
+
+    //  clear
+    //
+    void clear()
+    {
+        _count.assign(DateIndex::interval(), 0);
+        _date.clear();
+        _day.clear();
+    }
+
+    //  size
+    //      Number of trading days.
+    //
+    inline DayType size() const { return DayType(_date.size()); }
+
+    //  date
+    //      Date index of a trading day.
+    //
+    inline DateIndex::IndexType date(DayType day) const { return _date[day]; }
+
+    //  day
+    //      Trading day of a date index, or -1 if nothing traded then.
+    //
+    inline DayType day(DateIndex::IndexType date) const
+    {
+        return ((0 <= date) && (DateIndex::interval() > date)) ? _day[date] : -1;
+    }
+
+    //  first_from
+    //      First trading day on or after a date index, size() if none.
+    //
+    DayType first_from(DateIndex::IndexType date) const
+    {
+        if (0 > date) date = 0;
+        for (; date < DateIndex::interval(); ++date)
+            if (0 <= _day[date]) return _day[date];
+        return size();
+    }
+
+    //  samples
+    //      Number of samples counted on a trading day.
+    //
+    inline int samples(DayType day) const { return _count[_date[day]]; }
+
+protected:
+    //  _count
+    //      Samples by date index.
+    //
+    vector<int>                  _count;
+
+    //  _date
+    //  _day
+    //      Date index of each trading day, and trading day (or -1)
+    //      of each date index.
+    //
+    vector<DateIndex::IndexType> _date;
+    vector<DayType>              _day;
+};
+
+#endif // TRADING_CALENDAR_H
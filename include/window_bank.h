@@ -0,0 +1,435 @@
+#ifndef WINDOW_BANK_H
+#define WINDOW_BANK_H
+
+#include "numerictypes.h"
+#include "source_data.h"
+#include "accumulator.h"
+#include "correlations.h"
+#include <tuple>
+#include <utility>
+#include <deque>
+#include <string>
+
+using namespace std;
+
+//  Window Bank
+//      A compile-time list of moving average lengths. Every length
+//      gets its own MovingAverageN / CorrelatorN specialization, so
+//      there are no runtime-length loops. The 10- and 50-day data in
+//      StatisticalData stay as they are; the bank is written to its
+//      own set of files.
+//
+
+//  WindowLengths
+//      The list of lengths.
+//      Ns - window lengths in days, shortest first.
+//
+template<int... Ns>
+struct WindowLengths
+{
+    //  count
+    //      Number of windows in the bank.
+    //
+    static const int count = sizeof...(Ns);
+
+    //  length
+    //      Length of the i'th window.
+    //
+    inline static int length(int i)
+    {
+        static const int lengths[] = { Ns... };
+        return lengths[i];
+    }
+
+    //  index_of
+    //      Position of a window length in the bank or -1.
+    //
+    inline static int index_of(int n)
+    {
+        for (int i = 0; i < count; ++i)
+            if (length(i) == n) return i;
+        return -1;
+    }
+};
+
+
+//  BankedStatisticalData
+//      Current value plus one NDayType per window length.
+//      Real - some numeric type.
+//
+template<class Real, int... Ns>
+struct BankedStatisticalData
+{
+    typedef tuple< NDayType<Real, Ns>... > NDays;
+
+    //  Size
+    //      Used to determine offsets into data files.
+    //      Returns the size of the data structure.
+    //
+    inline static int Size()
+    {
+        return( sizeof(Real) + (NDayType<Real, Ns>::Size() + ...) );
+    }
+
+    //  value
+    //      Current value for comparison (among other things).
+    //
+    Real value;
+
+    //  nday
+    //      Moving average data, one per window length.
+    //
+    NDays nday;
+
+    //  is_valid
+    //      Same test as StatisticalData.
+    //
+    static bool is_valid(const BankedStatisticalData& sd)
+    {
+        return (Real::is_valid(sd.value));
+    }
+};
+
+//  Stream I/O operators.
+//  operator<<
+//      out - output stream.
+//      sd  - BankedStatisticalData to stream.
+//      returns - stream for continued use.
+//
+template<class Real, int... Ns>
+ostream& operator<< (ostream& out, const BankedStatisticalData<Real, Ns...>& sd)
+{
+    out << sd.value;
+    apply([&out](const NDayType<Real, Ns>&... nd) { (out << ... << nd); },
+          sd.nday);
+    return out;
+}
+
+//  operator>>
+//      in - input stream.
+//      sd - BankedStatisticalData to stream.
+//      returns - stream for continued use.
+//
+template<class Real, int... Ns>
+istream& operator>> (istream& in, BankedStatisticalData<Real, Ns...>& sd)
+{
+    in >> sd.value;
+    apply([&in](NDayType<Real, Ns>&... nd) { (in >> ... >> nd); },
+          sd.nday);
+    return in;
+}
+
+//  BlockCodec
+//      The value, then each window's NDayType in bank order.
+//
+template<class Real, int... Ns>
+struct BlockCodec< BankedStatisticalData<Real, Ns...> >
+{
+    typedef BankedStatisticalData<Real, Ns...> Data;
+
+    static const bool enabled = true;
+    static const int  layout  = layout_banked_statistical_data;
+
+    inline static int real_width() { return sizeof(Real); }
+
+    inline static size_t size() { return Data::Size(); }
+
+    inline static void pack(const Data& sd, char * out)
+    {
+        memcpy(out, &(sd.value.value), sizeof(Real));
+        out += sizeof(Real);
+        apply([&out](const NDayType<Real, Ns>&... nd)
+              {
+                  ((BlockCodec< NDayType<Real, Ns> >::pack(nd, out),
+                    out += NDayType<Real, Ns>::Size()), ...);
+              },
+              sd.nday);
+    }
+
+    inline static void unpack(const char * in, Data& sd)
+    {
+        memcpy(&(sd.value.value), in, sizeof(Real));
+        in += sizeof(Real);
+        apply([&in](NDayType<Real, Ns>&... nd)
+              {
+                  ((BlockCodec< NDayType<Real, Ns> >::unpack(in, nd),
+                    in += NDayType<Real, Ns>::Size()), ...);
+              },
+              sd.nday);
+    }
+};
+
+
+//  BankedMovingAverages
+//      One MovingAverageN per window length.
+//
+template<class Real, int... Ns>
+class BankedMovingAverages
+{
+public:
+    typedef tuple< MovingAverageN<Real, Ns>... > Accumulators;
+
+    //  update
+    //      Add a new value into every rolling accumulator.
+    //
+    inline void update(const Real& new_value,
+                       BankedStatisticalData<Real, Ns...>& sdata)
+    {
+        sdata.value = new_value;
+
+        if(Real::is_valid(new_value))
+            update_each(new_value, sdata, make_index_sequence<sizeof...(Ns)>());
+    }
+
+    //  reset
+    //      Resets to completely uninitialized.
+    //
+    inline void reset()
+    {
+        apply([](MovingAverageN<Real, Ns>&... ma) { (ma.reset(), ...); },
+              _accumulator);
+    }
+
+    //  accumulators
+    //      Expose the accumulators for checkpointing.
+    //
+    inline Accumulators& accumulators() { return _accumulator; }
+    inline const Accumulators& accumulators() const { return _accumulator; }
+
+protected:
+    template<size_t... I>
+    inline void update_each(const Real& new_value,
+                            BankedStatisticalData<Real, Ns...>& sdata,
+                            index_sequence<I...>)
+    {
+        (get<I>(_accumulator).update(new_value, get<I>(sdata.nday)), ...);
+    }
+
+    //  _accumulator
+    //      One accumulator per window length.
+    //
+    Accumulators _accumulator;
+};
+
+//  Stream I/O operators.
+//  operator<<
+//      Save the state of every accumulator in the bank.
+//
+template<class Real, int... Ns>
+ostream& operator<< (ostream& out, const BankedMovingAverages<Real, Ns...>& ma)
+{
+    apply([&out](const MovingAverageN<Real, Ns>&... a) { (out << ... << a); },
+          ma.accumulators());
+    return out;
+}
+
+//  operator>>
+//      Restore the state of every accumulator in the bank.
+//
+template<class Real, int... Ns>
+istream& operator>> (istream& in, BankedMovingAverages<Real, Ns...>& ma)
+{
+    apply([&in](MovingAverageN<Real, Ns>&... a) { (in >> ... >> a); },
+          ma.accumulators());
+    return in;
+}
+
+
+//  BankedCorrelations
+//      One correlation per window length.
+//      Windows that weren't computed hold the invalid value.
+//
+template<class Real, int Count>
+struct BankedCorrelations
+{
+    //  r
+    //      Correlation between two N-day moving averages,
+    //      in window bank order.
+    //
+    Real r[Count];
+};
+
+//  Stream I/O operators.
+//
+template<class Real, int Count>
+ostream& operator<< (ostream& out, const BankedCorrelations<Real, Count>& c)
+{
+    if (constants::save_as_binary)
+        out.write((char *)(&c), sizeof(BankedCorrelations<Real, Count>));
+    else
+    {
+        for (int i = 0; i < Count; ++i) out << c.r[i];
+        out << endl;
+    }
+
+    return out;
+}
+
+template<class Real, int Count>
+istream& operator>> (istream& in, BankedCorrelations<Real, Count>& c)
+{
+    if (constants::save_as_binary)
+        in.read((char *)(&c), sizeof(BankedCorrelations<Real, Count>));
+    else
+        for (int i = 0; i < Count; ++i) in >> c.r[i];
+
+    return in;
+}
+
+//  BlockCodec
+//      Stored as is.
+//
+template<class Real, int Count>
+struct BlockCodec< BankedCorrelations<Real, Count> > :
+    public DirectBlockCodec< BankedCorrelations<Real, Count>,
+                             layout_banked_correlations,
+                             sizeof(Real) > { };
+
+
+//  BankedCorrelator
+//      Correlate any subset of the window bank in one pass over a pair.
+//
+template<class Real, int... Ns>
+class BankedCorrelator
+{
+public:
+    typedef WindowLengths<Ns...>                          Lengths;
+    typedef BankedCorrelations<Real, sizeof...(Ns)>       CorrelationsType;
+    typedef BankedStatisticalData<Real, Ns...>            StatisticalDataType;
+
+    //  Constructor
+    //
+    inline BankedCorrelator() { }
+
+    //  select
+    //      Choose the windows to compute. Bit i selects Lengths::length(i).
+    //      Shared by all correlators (set it before starting threads).
+    //
+    inline static void select(unsigned int mask) { s_selected = mask; }
+    inline static unsigned int selected() { return s_selected; }
+
+    //  compute
+    //      Compute the selected correlations between two sets of
+    //      moving averages.
+    //
+    inline void compute(CorrelationsType&           cs,
+                        const StatisticalDataType&  sd_one,
+                        const StatisticalDataType&  sd_two)
+    {
+        compute_each(cs, sd_one, sd_two, make_index_sequence<sizeof...(Ns)>());
+    }
+
+protected:
+    template<size_t... I>
+    inline void compute_each(CorrelationsType&           cs,
+                             const StatisticalDataType&  sd_one,
+                             const StatisticalDataType&  sd_two,
+                             index_sequence<I...>)
+    {
+        ((cs.r[I] = (s_selected & (1u << I))
+            ? get<I>(_correlator).compute(get<I>(sd_one.nday),
+                                          get<I>(sd_two.nday))
+            : Real(Real::invalid_value)), ...);
+    }
+
+    //  _correlator
+    //      One specialized correlator per window length.
+    //
+    tuple< CorrelatorN<Real, Ns>... > _correlator;
+
+    //  s_selected
+    //      Windows to compute.
+    //
+    static unsigned int s_selected;
+
+    //  Do Not Copy
+    //
+    inline BankedCorrelator(const BankedCorrelator&) { }
+};
+
+template<class Real, int... Ns>
+unsigned int BankedCorrelator<Real, Ns...>::s_selected(~0u);
+
+
+//  WindowBank
+//      Bundle the types for a set of window lengths.
+//
+template<class Real, int... Ns>
+struct WindowBank
+{
+    typedef WindowLengths<Ns...>                      Lengths;
+    typedef BankedStatisticalData<Real, Ns...>        StatisticalDataType;
+    typedef BankedMovingAverages<Real, Ns...>         MovingAveragesType;
+    typedef BankedCorrelator<Real, Ns...>             CorrelatorType;
+    typedef typename CorrelatorType::CorrelationsType CorrelationsType;
+};
+
+
+//  Window bank file header
+//      Banked files start with a magic tag and the list of window
+//      lengths, so a reader built with a different bank fails
+//      instead of misreading the records. The records' FileHeader
+//      follows (see file_header.h).
+//
+const string window_bank_magic = "WNDW";
+
+//  save_window_header
+//      out - stream to write to.
+//
+template<class Lengths>
+void save_window_header(ostream& out)
+{
+    out.write(window_bank_magic.data(), window_bank_magic.length());
+    out << IntType(Lengths::count);
+    for (int i = 0; i < Lengths::count; ++i)
+        out << IntType(Lengths::length(i));
+}
+
+//  load_window_header
+//      in - stream to read from.
+//      returns true if the stream holds data for the same bank.
+//
+template<class Lengths>
+bool load_window_header(istream& in)
+{
+    string magic(window_bank_magic.length(), ' ');
+    in.read(&magic[0], magic.length());
+    if (!in.good() || (magic != window_bank_magic)) return false;
+
+    IntType count;
+    in >> count;
+    if (!in.good() || (Lengths::count != count)) return false;
+
+    for (int i = 0; i < Lengths::count; ++i)
+    {
+        IntType length;
+        in >> length;
+        if (!in.good() || (Lengths::length(i) != length)) return false;
+    }
+    return true;
+}
+
+
+//  Configuration
+//      The bank of windows computed by preprocess --window-bank and
+//      available to correlate --window-bank.
+//
+typedef WindowBank<FloatType, 5, 10, 20, 50, 100, 250> FloatWindowBank;
+
+typedef FloatWindowBank::StatisticalDataType  FloatBankedStatisticalData;
+typedef FloatWindowBank::MovingAveragesType   FloatBankedMovingAverages;
+typedef FloatWindowBank::CorrelatorType       FloatBankedCorrelator;
+typedef FloatWindowBank::CorrelationsType     FloatBankedCorrelations;
+
+typedef ExtendedContainer< FloatBankedStatisticalData,
+                           deque< FloatBankedStatisticalData > >
+                         FloatBankedStatisticalDeque;
+typedef ExtendedContainer< FloatBankedMovingAverages,
+                           deque< FloatBankedMovingAverages > >
+                         FloatBankedAccumulatorDeque;
+
+typedef CrossCorrelation< FloatType, FloatBankedCorrelations >
+                         FloatBankedCrossCorrelation;
+
+
+#endif // WINDOW_BANK_H
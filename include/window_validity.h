@@ -0,0 +1,161 @@
+#ifndef WINDOW_VALIDITY_H
+#define WINDOW_VALIDITY_H
+
+#include "numerictypes.h"
+#include "file_header.h"
+#include "directories.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <fstream>
+
+using namespace std;
+
+//  Window Validity
+//      Which days of each row's moving averages the symbol really
+//      traded on. preprocess feeds a symbol that didn't trade (or has
+//      no close before) a change of 0 to keep the windows a fixed
+//      length; these bits say which samples are made up that way, so
+//      correlate --pairwise can leave them out.
+//
+//      One 64 bit word per row of the day's means, bit i for
+//      fifty_day.residual[i] (oldest first). The 10-day window is the
+//      last 10 of those days, bits 40 to 49.
+//
+//      Written by preprocess into each day's means directory as
+//      constants::window_validity:
+//          FileHeader  - layout_window_validity, count = rows, date.
+//          words       - uint64 per row.
+//
+class WindowValidity
+{
+public:
+    //  days
+    //      Days covered: the 50-day window.
+    //
+    static const int days = 50;
+
+    //  Constructor
+    //
+    inline WindowValidity() : _date(-1) { }
+
+    //  window
+    //      The bits of an N day window, bit i for residual[i], out of
+    //      a row's word.
+    //
+    template<int N>
+    inline static uint64_t window(uint64_t valid)
+    {
+        static_assert((0 < N) && (days >= N), "window within the 50 days");
+        return (valid >> (days - N)) & ((uint64_t(1) << N) - 1);
+    }
+
+    //  assign
+    //      Set the rows of a day.
+    //
+    inline void assign(const vector<uint64_t>& valid, int date)
+    {
+        _valid = valid;
+        _date  = date;
+    }
+
+    //  size
+    //  date
+    //      Rows, and the day.
+    //
+    inline size_t size() const { return _valid.size(); }
+    inline int date() const    { return _date; }
+
+    //  operator[]
+    //      Word of a row.
+    //
+    inline uint64_t operator[](size_t row) const { return _valid[row]; }
+
+    //  save
+    //      Write the words into a directory.
+    //      returns true if written.
+    //
+    bool save(const Directory& dir, const string& name) const
+    {
+        OutFile out(dir, name, ios_base::out | ios_base::binary);
+        if (!out.is_open()) return false;
+
+        FileHeader header = FileHeader::describe<IntType>(_valid.size(),
+                                                          _valid.size(), _date);
+        header.layout      = layout_window_validity;
+        header.record_size = sizeof(uint64_t);
+        header.real_width  = 0;
+        header.save(out);
+        if (!_valid.empty())
+            out.write((const char *)(&_valid[0]), _valid.size() * sizeof(uint64_t));
+
+        return out.good();
+    }
+
+    //  load
+    //      Read the words of a day.
+    //      filename - validity file.
+    //      returns false if missing or damaged; leaves it empty.
+    //
+    bool load(const char * filename)
+    {
+        ifstream in(filename, ios_base::in | ios_base::binary);
+        return load(in);
+    }
+
+    //  load
+    //      Read the words of a day from a directory.
+    //      dir  - open directory.
+    //      name - validity file in it.
+    //
+    bool load(const Directory& dir, const string& name)
+    {
+        InFile in(dir, name, ios_base::in | ios_base::binary);
+        return load(in);
+    }
+
+    //  load
+    //      Read the words of a day from an open stream.
+    //
+    bool load(istream& in)
+    {
+        clear();
+
+        FileHeader header;
+        if (!in.good() || !header.load(in))                 return false;
+        if ((FileHeader::current_version < header.version) ||
+            (layout_window_validity != header.layout)      ||
+            (sizeof(uint64_t) != header.record_size)       ||
+            (FileHeader::endian_marker != header.endian)   )  return false;
+
+        _date = header.date;
+        _valid.resize(header.count);
+        if (!_valid.empty())
+            in.read((char *)(&_valid[0]), _valid.size() * sizeof(uint64_t));
+        if (!in.good())
+        {
+            clear();
+            return false;
+        }
+        return true;
+    }
+
+    //  clear
+    //
+    void clear()
+    {
+        _valid.clear();
+        _date = -1;
+    }
+
+protected:
+    //  _valid
+    //  _date
+    //      Word of each row, and the day.
+    //
+    vector<uint64_t> _valid;
+    int              _date;
+};
+
+#endif // WINDOW_VALIDITY_H
@@ -0,0 +1,327 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "../include/parsers.h"
+#include "../include/mapped_file.h"
+#include "../include/csv_scanner.h"
+#include "../include/date_index.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+//  Stopwatch
+//      Seconds since it was started.
+//
+class Stopwatch
+{
+public:
+    inline Stopwatch() :
+        _start(boost::posix_time::microsec_clock::universal_time()) { }
+
+    inline double seconds() const
+    {
+        return (boost::posix_time::microsec_clock::universal_time() -
+                _start).total_microseconds() / 1.0e6;
+    }
+
+protected:
+    boost::posix_time::ptime _start;
+};
+
+
+//  make_csv
+//      A made up Yahoo! CSV file, the same on every run.
+//      rows        - lines after the header.
+//      quote_every - quote the date of every so many lines, 0 for none.
+//
+string make_csv(size_t rows, size_t quote_every)
+{
+    string csv("Date,Open,High,Low,Close,Volume,Adj Close\n");
+    csv.reserve(rows * 64);
+
+    uint32_t state = 1;
+    long     close = 2000;
+    char     line[128];
+    for (size_t i = 0; i < rows; ++i)
+    {
+        state = state * 1664525u + 1013904223u;
+        close += long((state >> 8) % 41) - 20;
+        if (100 > close) close = 100;
+
+        bool quote = (0 != quote_every) && (0 == i % quote_every);
+        ::snprintf(line, sizeof(line),
+                   "%s%04d-%02d-%02d%s,%.2f,%.2f,%.2f,%.2f,%ld,%.2f\n",
+                   quote ? "\"" : "",
+                   int(1970 + i / 336), int(1 + (i / 28) % 12), int(1 + i % 28),
+                   quote ? "\"" : "",
+                   close / 100.0, (close + 25) / 100.0, (close - 25) / 100.0,
+                   close / 100.0, long(state % 100000000), close / 100.0);
+        csv += line;
+    }
+    return csv;
+}
+
+
+//  Tally
+//      What the rules saw, to check every splitter saw the same.
+//
+struct Tally
+{
+    size_t lines;
+    size_t fields;
+    size_t bytes;
+
+    inline Tally() : lines(0), fields(0), bytes(0) { }
+
+    inline bool operator==(const Tally& t) const
+    {
+        return (lines == t.lines) && (fields == t.fields) && (bytes == t.bytes);
+    }
+};
+
+void tally_fields(const fieldvector& elements, Tally& t)
+{
+    ++t.lines;
+    t.fields += elements.size();
+    for (size_t i = 0; i < elements.size(); ++i)
+        t.bytes += elements[i].size();
+}
+
+void tally_strings(const stringvector& elements, Tally& t)
+{
+    ++t.lines;
+    t.fields += elements.size();
+    for (size_t i = 0; i < elements.size(); ++i)
+        t.bytes += elements[i].size();
+}
+
+
+//  Splitters
+//      Each splits the lines after the header into fields and hands
+//      them to a tally rule.
+//
+//  split_getline
+//      A line at a time from a stream through LineParser, the way
+//      FileParser does.
+//
+Tally split_getline(const string& body)
+{
+    Tally      t;
+    istringstream source(body);
+    LineParser lp(",");
+    string     line;
+    while (getline(source, line))
+        if (!line.empty()) lp.parse(line, tally_strings, t);
+    return t;
+}
+
+//  split_find
+//      Finding each newline, then each delimiter, with FieldParser.
+//
+Tally split_find(string_view body)
+{
+    Tally       t;
+    FieldParser fp(",");
+    size_t      begin = 0;
+    while (body.size() > begin)
+    {
+        size_t end = body.find('\n', begin);
+        if (string_view::npos == end) end = body.size();
+
+        if (begin < end) fp.parse(body.substr(begin, end - begin), tally_fields, t);
+        begin = end + 1;
+    }
+    return t;
+}
+
+//  split_scanned
+//      The structural scanner, the way MappedFileParser does.
+//
+template<class Lanes>
+Tally split_scanned(string_view body)
+{
+    Tally t;
+    StructuralScanner<Lanes> scanner(",");
+    ScannedLineParser<void(const fieldvector&, Tally&), Tally>
+        lines(",", tally_fields, t);
+    scanner.scan(body, lines);
+    return t;
+}
+
+
+//  time
+//      Best of a few runs of a splitter, and a line of results.
+//      returns false if it didn't see what the first one did.
+//
+template<class Splitter>
+bool time(const char * what, Splitter split, int runs,
+          double gigabytes, Tally& expected, bool first)
+{
+    double best = 1e30;
+    Tally  t;
+    for (int run = 0; run < runs; ++run)
+    {
+        Stopwatch watch;
+        t = split();
+        double seconds = watch.seconds();
+        if (seconds < best) best = seconds;
+    }
+
+    if (first) expected = t;
+    bool ok = (expected == t);
+
+    ::printf("%-22s %9.4f s  %7.2f GB/s  %zu lines, %zu fields%s\n",
+             what, best, gigabytes / best, t.lines, t.fields,
+             ok ? "" : "  DIFFERENT!");
+    return ok;
+}
+
+
+//  Dates
+//      Per line cost of turning the date field into a DateIndex:
+//      through boost::gregorian::from_simple_string, as it used to be,
+//      and with DateIndex::from_string.
+//
+void take_date(const fieldvector& elements, vector<string_view>& dates)
+{
+    if (!elements.empty()) dates.push_back(elements[0]);
+}
+
+bool time_dates(string_view body, int runs)
+{
+    vector<string_view> dates;
+    {
+        StructuralScanner<> scanner(",");
+        ScannedLineParser<void(const fieldvector&, vector<string_view>&),
+                          vector<string_view> > lines(",", take_date, dates);
+        scanner.scan(body, lines);
+    }
+    if (dates.empty()) return true;
+
+    long   zero = constants::start_date.julian_day();
+    double boost_best = 1e30, fast_best = 1e30;
+    long   boost_sum = 0, fast_sum = 0;
+    for (int run = 0; run < runs; ++run)
+    {
+        {
+            Stopwatch watch;
+            boost_sum = 0;
+            for (size_t i = 0; i < dates.size(); ++i)
+            {
+                try
+                {
+                    boost_sum += boost::gregorian::from_simple_string(
+                                     string(dates[i])).julian_day() - zero;
+                }
+                catch(...) { boost_sum -= 1; }
+            }
+            double seconds = watch.seconds();
+            if (seconds < boost_best) boost_best = seconds;
+        }
+        {
+            Stopwatch watch;
+            fast_sum = 0;
+            for (size_t i = 0; i < dates.size(); ++i)
+                fast_sum += DateIndex::from_string(dates[i]);
+            double seconds = watch.seconds();
+            if (seconds < fast_best) fast_best = seconds;
+        }
+    }
+
+    bool ok = (boost_sum == fast_sum);
+    ::printf("dates: from_simple_string %.1f ns, DateIndex::from_string %.1f ns a line%s\n",
+             boost_best * 1.0e9 / dates.size(), fast_best * 1.0e9 / dates.size(),
+             ok ? "" : "  DIFFERENT!");
+    return ok;
+}
+
+
+// main
+//      Time splitting a CSV file into fields: a line at a time through
+//      a stream, with string_view finds, and with the structural
+//      scanner both scalar and in vector lanes. Then time reading the
+//      dates.
+//
+int main(int ac, char * av[])
+{
+    size_t rows        = 2000000;
+    size_t quote_every = 0;
+    int    runs        = 3;
+    string file;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "bench_csv - Time splitting CSV files into fields.")
+        ("rows", po::value< size_t >(&rows),
+         "Lines of made up Yahoo! CSV (default 2000000).")
+        ("quote-every", po::value< size_t >(&quote_every),
+         "Quote the date of every so many lines (default 0, none).")
+        ("file", po::value< string >(&file),
+         "Split this CSV file instead of a made up one.")
+        ("runs", po::value< int >(&runs),
+         "Runs of each, the best is kept (default 3).")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+    if (1 > runs) runs = 1;
+
+    MappedFile  mapped;
+    string      made;
+    string_view text;
+    if (!file.empty())
+    {
+        if (!mapped.open(file.c_str()))
+        {
+            ::printf("Error failed to open file: %s\n", file.c_str());
+            return 1;
+        }
+        text = mapped.text();
+    }
+    else
+    {
+        made = make_csv(rows, quote_every);
+        text = made;
+    }
+
+    // skip past the header.
+    size_t begin = text.find('\n');
+    string_view body = (string_view::npos == begin) ? string_view()
+                                                     : text.substr(begin + 1);
+    string body_copy(body);
+    double gigabytes = body.size() / 1.0e9;
+
+    ::printf("%.1f MB of CSV, %i byte lanes\n",
+             body.size() / (1024.0 * 1024.0), ByteLanes::width);
+
+    Tally expected;
+    bool  ok = true;
+    ok = time("getline, LineParser",
+              [&]() { return split_getline(body_copy); },
+              runs, gigabytes, expected, true) && ok;
+    ok = time("find, FieldParser",
+              [&]() { return split_find(body); },
+              runs, gigabytes, expected, false) && ok;
+    ok = time("scanner, scalar",
+              [&]() { return split_scanned<ScalarBytes>(body); },
+              runs, gigabytes, expected, false) && ok;
+    ok = time("scanner, lanes",
+              [&]() { return split_scanned<ByteLanes>(body); },
+              runs, gigabytes, expected, false) && ok;
+    ok = time_dates(body, runs) && ok;
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,559 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "../include/container_io.h"
+#include "../include/tickers.h"
+#include "../include/source_data.h"
+#include "../include/correlations.h"
+#include "../include/tick_store.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+//  Stopwatch
+//      Seconds since it was started.
+//
+class Stopwatch
+{
+public:
+    inline Stopwatch() :
+        _start(boost::posix_time::microsec_clock::universal_time()) { }
+
+    inline double seconds() const
+    {
+        return (boost::posix_time::microsec_clock::universal_time() -
+                _start).total_microseconds() / 1.0e6;
+    }
+
+protected:
+    boost::posix_time::ptime _start;
+};
+
+
+//  Generators
+//      Made up records that look like the real ones, the same on
+//      every run.
+//
+inline uint32_t next_random(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+inline float next_float(uint32_t& state)
+{
+    return float(next_random(state) % 20001) / 10000.0f - 1.0f;
+}
+
+void make_ticks(TickerSet& ticks, size_t count)
+{
+    uint32_t state = 1;
+    long     close = 2000;
+    ticks.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        close += long(next_random(state) % 41) - 20;
+        ticks[i].index = DateIndex::IndexType(i % 5000);
+        ticks[i].value.CloseNoBkg.value = close;
+    }
+}
+
+template<class Real, int N>
+void fill(NDayType<Real, N>& nd, uint32_t& state)
+{
+    nd.mean = next_float(state);
+    for (int i = 0; i < N; ++i)
+        nd.residual[i] = next_float(state);
+    nd.root_mean_square = next_float(state) + 1.0f;
+}
+
+void make_means(FloatStatisticalDeque& means, size_t count)
+{
+    uint32_t state = 2;
+    means.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        means[i].value = next_float(state);
+        fill(means[i].fifty_day, state);
+        fill(means[i].ten_day, state);
+    }
+}
+
+void make_slice(vector<FloatCorrelations>& slice, size_t count)
+{
+    uint32_t state = 3;
+    slice.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        slice[i].fifty_day = next_float(state);
+        slice[i].ten_day   = next_float(state);
+    }
+}
+
+
+//  same
+//      Compare two containers by their block form.
+//
+template<class STL_Container>
+bool same(const STL_Container& a, const STL_Container& b)
+{
+    if (a.size() != b.size()) return false;
+
+    ostringstream one, two;
+    save_block_to(a, one);
+    save_block_to(b, two);
+    return one.str() == two.str();
+}
+
+
+//  Results
+//      Best times of each way of moving a container, in seconds.
+//
+struct Results
+{
+    double save_elements;
+    double save_blocks;
+    double save_encoded;
+    double load_elements;
+    double load_blocks;
+    double load_encoded;
+
+    inline Results() :
+        save_elements(1e30), save_blocks(1e30), save_encoded(1e30),
+        load_elements(1e30), load_blocks(1e30), load_encoded(1e30) { }
+
+    inline static void keep_best(double& best, const Stopwatch& watch)
+    {
+        double seconds = watch.seconds();
+        if (seconds < best) best = seconds;
+    }
+};
+
+
+//  print
+//      One line per direction: the per-element time, the block time,
+//      the speed up and the block rate.
+//
+void print(const char * what, const Results& r, double megabytes)
+{
+    ::printf("%-6s save  %9.4f s  %9.4f s  x%5.1f  %8.1f MB/s\n", what,
+             r.save_elements, r.save_blocks,
+             r.save_elements / r.save_blocks, megabytes / r.save_blocks);
+    ::printf("%-6s load  %9.4f s  %9.4f s  x%5.1f  %8.1f MB/s\n", what,
+             r.load_elements, r.load_blocks,
+             r.load_elements / r.load_blocks, megabytes / r.load_blocks);
+    if (r.save_encoded < 1e30)
+        ::printf("%-6s encoded save %.4f s, load %.4f s\n", what,
+                 r.save_encoded, r.load_encoded);
+}
+
+
+//  bench
+//      Save and load a container to a file record by record
+//      (save_elements_to, load_elements_from) and a block at a time
+//      (save_block_to, load_block_from), and for types that have one
+//      in the encoded form, keeping the best of a few runs of each.
+//      what - name of the records.
+//      c    - the records.
+//      path - scratch file.
+//      runs - times to repeat each.
+//      returns false if something didn't load back as it was saved.
+//
+template<class STL_Container>
+bool bench(const char * what, const STL_Container& c,
+           const string& path, int runs)
+{
+    typedef typename STL_Container::value_type T;
+
+    Results r;
+    bool    ok = true;
+    for (int run = 0; run < runs; ++run)
+    {
+        {
+            ofstream out(path.c_str(), ios_base::out | ios_base::binary);
+            Stopwatch watch;
+            save_elements_to(c, out);
+            out.flush();
+            Results::keep_best(r.save_elements, watch);
+        }
+        {
+            STL_Container loaded;
+            ifstream in(path.c_str(), ios_base::in | ios_base::binary);
+            Stopwatch watch;
+            load_elements_from(loaded, in);
+            Results::keep_best(r.load_elements, watch);
+            ok = ok && same(c, loaded);
+        }
+        {
+            ofstream out(path.c_str(), ios_base::out | ios_base::binary);
+            Stopwatch watch;
+            save_block_to(c, out);
+            out.flush();
+            Results::keep_best(r.save_blocks, watch);
+        }
+        {
+            STL_Container loaded;
+            ifstream in(path.c_str(), ios_base::in | ios_base::binary);
+            Stopwatch watch;
+            load_block_from(loaded, in);
+            Results::keep_best(r.load_blocks, watch);
+            ok = ok && same(c, loaded);
+        }
+        if constexpr (RecordEncoding<T>::enabled)
+        {
+            {
+                ofstream out(path.c_str(), ios_base::out | ios_base::binary);
+                Stopwatch watch;
+                save_encoded_to(c, out);
+                out.flush();
+                Results::keep_best(r.save_encoded, watch);
+            }
+            {
+                STL_Container loaded;
+                ifstream in(path.c_str(), ios_base::in | ios_base::binary);
+                Stopwatch watch;
+                load_encoded_from(loaded, in, c.size());
+                Results::keep_best(r.load_encoded, watch);
+                ok = ok && same(c, loaded);
+            }
+        }
+    }
+    ::remove(path.c_str());
+
+    print(what, r, c.size() * BlockCodec<T>::size() / (1024.0 * 1024.0));
+    if (!ok) ::printf("%-6s didn't load back as saved!\n", what);
+    return ok;
+}
+
+
+//  same_record
+//      Compare two records by their block form.
+//
+template<class T>
+bool same_record(const T& a, const T& b)
+{
+    vector<char> one(BlockCodec<T>::size()), two(BlockCodec<T>::size());
+    BlockCodec<T>::pack(a, &one[0]);
+    BlockCodec<T>::pack(b, &two[0]);
+    return one == two;
+}
+
+
+//  lookups
+//      Read records out of a file by index through a
+//      BufferedTickerReader, checking each against the container.
+//      reader - open reader.
+//      c      - the records in the file.
+//      index  - indexes to read, in order.
+//      best   - best time so far, in seconds.
+//      returns false if a record didn't read back as saved.
+//
+bool lookups(BufferedTickerReader& reader, const TickerSet& c,
+             const vector<size_t>& index, double& best)
+{
+    bool   ok = true;
+    Ticker t;
+    reader.reset_counters();
+
+    Stopwatch watch;
+    for (size_t i = 0; i < index.size(); ++i)
+        ok = reader.read(int(index[i]), t) && same_record(t, c[index[i]]) && ok;
+    Results::keep_best(best, watch);
+    return ok;
+}
+
+
+//  bench_reader
+//      Read ticks out of a file one at a time by index, in order and
+//      then wandering at random a few thousand ticks either way,
+//      through BufferedTickerReader's block cache and through a cache
+//      of one block, which goes back to the file for nearly every
+//      wandering read. Then the same from the encoded form, which the
+//      reader decodes whole when it opens it. Also checks that a file
+//      of some other records isn't opened as ticks.
+//      c     - the ticks.
+//      path  - scratch file.
+//      runs  - times to repeat each.
+//      reads - wandering reads.
+//      returns false if something didn't read back as it was saved.
+//
+bool bench_reader(const TickerSet& c, const string& path, int runs, size_t reads)
+{
+    {
+        ofstream out(path.c_str(), ios_base::out | ios_base::binary);
+        FileHeader::describe<Ticker>(c.size(), 0, -1).save(out);
+        save_block_to(c, out);
+    }
+
+    vector<size_t> in_order(c.size()), wandering(c.empty() ? 0 : reads);
+    uint32_t state = 4;
+    size_t   at    = c.size() / 2;
+    for (size_t i = 0; i < in_order.size(); ++i) in_order[i] = i;
+    for (size_t i = 0; i < wandering.size(); ++i)
+    {
+        size_t step = next_random(state) % 4096 % c.size();
+        at = (next_random(state) & 1) ? (at + step) % c.size()
+                                      : (at + c.size() - step) % c.size();
+        wandering[i] = at;
+    }
+
+    bool ok = true;
+    const char * kind[] = { "cache", "1 block" };
+    size_t       cache_blocks[] = { BufferedTickerReader::default_cache_blocks, 1 };
+    for (int k = 0; k < 2; ++k)
+    {
+        BufferedTickerReader reader(path.c_str(),
+                                    BufferedTickerReader::default_block_size,
+                                    cache_blocks[k]);
+        ok = ok && reader.is_open();
+
+        double in_order_best = 1e30, wandering_best = 1e30;
+        size_t hits[2], misses[2];
+        for (int run = 0; run < runs && ok; ++run)
+        {
+            ok = lookups(reader, c, in_order, in_order_best) && ok;
+            hits[0] = reader.hits();
+            misses[0] = reader.misses();
+
+            ok = lookups(reader, c, wandering, wandering_best) && ok;
+            hits[1] = reader.hits();
+            misses[1] = reader.misses();
+        }
+        if (!ok) break;
+
+        ::printf("reader %-7s in order %9.4f s  %8zu hits %8zu misses\n",
+                 kind[k], in_order_best, hits[0], misses[0]);
+        ::printf("reader %-7s nearby   %9.4f s  %8zu hits %8zu misses\n",
+                 kind[k], wandering_best, hits[1], misses[1]);
+    }
+
+    if (ok)
+    {
+        {
+            ofstream out(path.c_str(), ios_base::out | ios_base::binary);
+            FileHeader::describe<Ticker>(c.size(), 0, -1, true).save(out);
+            save_encoded_to(c, out);
+        }
+
+        double open_best = 1e30, in_order_best = 1e30, wandering_best = 1e30;
+        for (int run = 0; run < runs && ok; ++run)
+        {
+            Stopwatch watch;
+            BufferedTickerReader reader(path.c_str());
+            Results::keep_best(open_best, watch);
+
+            ok = reader.is_open() &&
+                 lookups(reader, c, in_order, in_order_best) &&
+                 lookups(reader, c, wandering, wandering_best);
+        }
+        if (ok)
+            ::printf("reader encoded open %.4f s, in order %.4f s, nearby %.4f s\n",
+                     open_best, in_order_best, wandering_best);
+    }
+
+    {
+        FloatStatisticalDeque means;
+        make_means(means, 10);
+        ofstream out(path.c_str(), ios_base::out | ios_base::binary);
+        FileHeader::describe<FloatStatisticalData>(means.size(), 0, -1).save(out);
+        save_block_to(means, out);
+    }
+    {
+        BufferedTickerReader reader(path.c_str());
+        if (reader.is_open())
+        {
+            ::puts("reader opened a file of means as ticks!");
+            ok = false;
+        }
+    }
+    ::remove(path.c_str());
+
+    if (!ok) ::puts("reader didn't read back the ticks as saved!");
+    return ok;
+}
+
+
+//  same_signal
+//      Compare two ticker signals day by day.
+//
+bool same_signal(const TickerSignal& a, const TickerSignal& b)
+{
+    if (a.sample.size() != b.sample.size()) return false;
+
+    for (size_t d = 0; d < a.sample.size(); ++d)
+    {
+        const Tick& x = a.sample[d];
+        const Tick& y = b.sample[d];
+        bool valid = Tick::is_valid(x);
+        if ((valid != Tick::is_valid(y)) ||
+            (valid && (x.CloseNoBkg.value != y.CloseNoBkg.value)))
+            return false;
+    }
+    return true;
+}
+
+
+//  bench_store
+//      Load the closes of some symbols as preprocess does: from a tick
+//      file per symbol, and from one tick store written by
+//      TickStoreWriter, checking that both give the same signals.
+//      Each symbol misses about one day in ten.
+//      symbols   - number of symbols.
+//      directory - where to put the scratch files.
+//      runs      - times to repeat each.
+//      returns false if the store's signals aren't the files'.
+//
+bool bench_store(size_t symbols, const string& directory, int runs)
+{
+    SymbolDescriptorSet list;
+    vector<string>      files;
+    TickStoreWriter     writer;
+    uint32_t            state = 5;
+    for (size_t i = 0; i < symbols; ++i)
+    {
+        string symbol = "B" + boost::lexical_cast<string>(i);
+        list.push_back(SymbolDescriptor(symbol, "", "", "", ""));
+        files.push_back(directory + "/bench_io." + symbol + ".ticks");
+
+        TickerSet ticks;
+        long      close = 2000;
+        for (int d = 0; d < DateIndex::interval(); ++d)
+        {
+            close += long(next_random(state) % 41) - 20;
+            if (0 == next_random(state) % 10) continue;
+
+            ticks.push_back(Ticker(d, Tick(close)));
+        }
+        writer.add(symbol, ticks);
+        save_to(ticks, files.back().c_str());
+    }
+
+    string store_path = directory + "/bench_io.store";
+    bool   ok = writer.save(list, store_path.c_str());
+
+    double files_best = 1e30, store_best = 1e30;
+    for (int run = 0; run < runs && ok; ++run)
+    {
+        TickerSignalDeque from_files, from_store;
+        from_files.resize(symbols);
+        from_store.resize(symbols);
+        {
+            Stopwatch watch;
+            for (size_t i = 0; i < symbols; ++i)
+                from_files[i].load_from(files[i].c_str());
+            Results::keep_best(files_best, watch);
+        }
+        {
+            Stopwatch watch;
+            TickStore store;
+            ok = store.open(store_path.c_str());
+            size_t i = 0;
+            BOOST_FOREACH(const SymbolDescriptor& sd, list)
+            {
+                int id = ok ? store.find(sd.Symbol) : -1;
+                if (0 > id)
+                {
+                    ok = false;
+                    break;
+                }
+                store.load(id, from_store[i++]);
+            }
+            Results::keep_best(store_best, watch);
+        }
+        for (size_t i = 0; i < symbols && ok; ++i)
+            ok = same_signal(from_files[i], from_store[i]);
+    }
+
+    BOOST_FOREACH(const string& file, files) ::remove(file.c_str());
+    ::remove(store_path.c_str());
+
+    if (ok)
+        ::printf("store  %zu symbols: files %.4f s, store %.4f s  x%5.1f\n",
+                 symbols, files_best, store_best, files_best / store_best);
+    else
+        ::puts("store  didn't load the same closes as the tick files!");
+    return ok;
+}
+
+
+// main
+//      Time the binary container I/O in container_io.h: record by
+//      record through the stream operators against a block at a time,
+//      for ticks, a day's means and a correlations slice. Then ticks
+//      read one at a time through BufferedTickerReader, and the closes
+//      of many symbols loaded from their tick files and from a tick
+//      store.
+//
+int main(int ac, char * av[])
+{
+    size_t ticks = 2000000;
+    size_t means = 8000;
+    size_t pairs = 8000000;
+    size_t reads = 1000000;
+    size_t symbols = 2000;
+    int    runs  = 3;
+    string directory(".");
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "bench_io - Time loading and saving binary containers.")
+        ("ticks", po::value< size_t >(&ticks),
+         "Ticks to move (default 2000000).")
+        ("means", po::value< size_t >(&means),
+         "Symbols' means to move (default 8000).")
+        ("pairs", po::value< size_t >(&pairs),
+         "Correlation pairs in the slice (default 8000000).")
+        ("reads", po::value< size_t >(&reads),
+         "Wandering reads of single ticks (default 1000000).")
+        ("symbols", po::value< size_t >(&symbols),
+         "Symbols in the tick store (default 2000).")
+        ("runs", po::value< int >(&runs),
+         "Runs of each, the best is kept (default 3).")
+        ("directory", po::value< string >(&directory),
+         "Where to put the scratch file (default .).")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+    if (1 > runs) runs = 1;
+
+    string path = directory + "/bench_io.scratch";
+    ::puts("Files are read back straight after they're written, so the loads");
+    ::puts("come from the page cache.");
+    ::puts("              per element      block");
+
+    bool ok = true;
+    {
+        TickerSet c;
+        make_ticks(c, ticks);
+        ok = bench("ticks", c, path, runs) && ok;
+        ok = bench_reader(c, path, runs, reads) && ok;
+    }
+    {
+        FloatStatisticalDeque c;
+        make_means(c, means);
+        ok = bench("means", c, path, runs) && ok;
+    }
+    {
+        vector<FloatCorrelations> c;
+        make_slice(c, pairs);
+        ok = bench("slice", c, path, runs) && ok;
+    }
+    ok = bench_store(symbols, directory, runs) && ok;
+
+    return ok ? 0 : 1;
+}
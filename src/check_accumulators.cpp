@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <iostream>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "../include/accumulator.h"
+#include "../include/batched_accumulator.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+//  next_random
+//  next_change
+//      Made up daily changes, the same on every run: mostly small,
+//      now and then a zero (a first close) or a big jump.
+//
+inline uint32_t next_random(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+inline float next_change(uint32_t& state)
+{
+    uint32_t r = next_random(state);
+    if (0 == r % 97) return 0.0f;
+    float change = float(r % 20001) / 10000.0f - 1.0f;
+    return (0 == r % 89) ? change * 40.0f : change * 0.03f;
+}
+
+
+//  check
+//      Run one batch of FloatLanes::width series through
+//      BatchedMovingAverages and each series through its own
+//      FloatMovingAverages, the way preprocess does, and compare what
+//      they write day by day. Lane 0 is never in use (padding past the
+//      last symbol), lane 1 is NaN (no update) on a run of days in the
+//      middle. Half way through the batch is copied out to scalar
+//      accumulators and back into a fresh one, as the checkpoint does.
+//      days  - length of the series.
+//      state - random number state.
+//      returns the number of symbol-days that differed.
+//
+int check(int days, uint32_t& state)
+{
+    const int W = FloatLanes::width;
+
+    BatchedMovingAverages               batched;
+    vector<FloatMovingAverages>         scalar(W);
+    vector<FloatStatisticalData>        batched_out(W), scalar_out(W);
+    FloatStatisticalData *              out[W];
+    float                               value[W] __attribute__((aligned(64)));
+
+    batched.reset();
+    for (int lane = 0; lane < W; ++lane)
+    {
+        scalar[lane].reset();
+        out[lane] = (0 == lane) ? 0 : &batched_out[lane];
+    }
+
+    int mismatches = 0;
+    for (int day = 0; day < days; ++day)
+    {
+        for (int lane = 0; lane < W; ++lane)
+        {
+            value[lane] = next_change(state);
+            if ((0 == lane) ||
+                ((1 == lane) && (days / 3 <= day) && (day < days / 2)))
+                value[lane] = FloatType::invalid_value;
+        }
+
+        batched.update(value, out);
+        for (int lane = 1; lane < W; ++lane)
+        {
+            scalar[lane].update(value[lane], scalar_out[lane]);
+            if (!same_statistics(batched_out[lane], scalar_out[lane]))
+                ++mismatches;
+        }
+
+        if (day == days / 2)
+        {
+            vector<FloatMovingAverages> saved(W);
+            for (int lane = 1; lane < W; ++lane)
+                batched.store_lane(lane, saved[lane]);
+            batched.reset();
+            for (int lane = 1; lane < W; ++lane)
+                batched.load_lane(lane, saved[lane]);
+        }
+    }
+    return mismatches;
+}
+
+
+// main
+//      Check that the batched accumulators (BatchedMovingAverages, as
+//      built with the flags given) write the same bits as the scalar
+//      ones. preprocess --simd-check does the same on real data.
+//
+int main(int ac, char * av[])
+{
+    int batches = 200;
+    int days    = 400;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "check_accumulators - Check the batched moving averages "
+                 "against the scalar ones.")
+        ("batches", po::value< int >(&batches),
+         "Batches of made up series (default 200).")
+        ("days", po::value< int >(&days),
+         "Days in each series (default 400).")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+
+    uint32_t state = 1;
+    int      mismatches = 0;
+    for (int batch = 0; batch < batches; ++batch)
+        mismatches += check(days, state);
+
+    ::printf("check_accumulators: %i lanes wide, %i of %i symbol-days differed.\n",
+             FloatLanes::width, mismatches,
+             batches * days * (FloatLanes::width - 1));
+    return (0 == mismatches) ? 0 : 1;
+}
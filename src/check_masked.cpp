@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include <iostream>
+#include <vector>
+#include <boost/program_options.hpp>
+#include "../include/masked_signal.h"
+
+namespace po = boost::program_options;
+using namespace std;
+
+
+//  next_random
+//  next_sample
+//      Made up samples, the same on every run: mostly small, now and
+//      then a missing one (NaN), and runs of missing ones.
+//
+inline uint32_t next_random(uint32_t& state)
+{
+    state = state * 1664525u + 1013904223u;
+    return state >> 8;
+}
+
+inline float next_sample(uint32_t& state, bool in_gap)
+{
+    uint32_t r = next_random(state);
+    if (in_gap || (0 == r % 7)) return FloatType::invalid_value;
+    return float(r % 20001) / 10000.0f - 1.0f;
+}
+
+
+//  close
+//      Return true if a masked float sum is near the double one, given
+//      the sum of the magnitudes that went into it.
+//
+inline bool close(float masked, double plain, double magnitude)
+{
+    return fabs(double(masked) - plain) <= 1.0e-5 * magnitude + 1.0e-6;
+}
+
+
+//  check
+//      Two made up signals of NaN's for missing samples, turned into
+//      masked signals, and each masked reduction (and the moments of
+//      the pair) compared with a plain loop that skips the NaN's.
+//      Then copied back out, which must give the same bits.
+//      samples - length of the signals.
+//      state   - random number state.
+//      returns the number of reductions that differed.
+//
+int check(size_t samples, uint32_t& state)
+{
+    FloatSignal x, y;
+    x.sample.resize(samples);
+    y.sample.resize(samples);
+    for (size_t i = 0; i < samples; ++i)
+    {
+        x.sample[i] = next_sample(state, (samples / 3 <= i) && (i < samples / 2));
+        y.sample[i] = next_sample(state, false);
+    }
+
+    MaskedSignal mx, my;
+    mx.assign(x);
+    my.assign(y);
+
+    size_t count_x = 0, count_xy = 0;
+    double sum = 0.0, sum_abs = 0.0, squares = 0.0, dot = 0.0, dot_abs = 0.0;
+    double both_x = 0.0, both_x_abs = 0.0, both_yy = 0.0;
+    for (size_t i = 0; i < samples; ++i)
+    {
+        if (!FloatType::is_valid(x.sample[i])) continue;
+
+        float v = x.sample[i].value;
+        ++count_x;
+        sum     += v;
+        sum_abs += fabs(v);
+        squares += double(v) * v;
+        if (!FloatType::is_valid(y.sample[i])) continue;
+
+        float w = y.sample[i].value;
+        ++count_xy;
+        dot        += double(v) * w;
+        dot_abs    += fabs(double(v) * w);
+        both_x     += v;
+        both_x_abs += fabs(v);
+        both_yy    += double(w) * w;
+    }
+
+    vector<uint64_t> both(mx.valid.size());
+    for (size_t w = 0; w < both.size(); ++w) both[w] = mx.valid[w] & my.valid[w];
+
+    const float *    px = mx.value.empty() ? 0 : &mx.value[0];
+    const float *    py = my.value.empty() ? 0 : &my.value[0];
+    const uint64_t * vx = mx.valid.empty() ? 0 : &mx.valid[0];
+    const uint64_t * vy = my.valid.empty() ? 0 : &my.valid[0];
+    const uint64_t * vb = both.empty()     ? 0 : &both[0];
+
+    int mismatches = 0;
+    if (count_x  != masked_count(vx, samples))     ++mismatches;
+    if (count_xy != masked_count(vx, vy, samples)) ++mismatches;
+    if (!close(masked_sum(px, vx, samples), sum, sum_abs))             ++mismatches;
+    if (!close(masked_sum(mx), sum, sum_abs))                          ++mismatches;
+    if (!close(masked_sum_of_squares(px, vx, samples), squares, squares)) ++mismatches;
+    if (!close(masked_dot(px, py, vb, samples), dot, dot_abs))         ++mismatches;
+
+    MaskedMoments m;
+    masked_moments(px, py, vb, samples, m);
+    if ((float(count_xy) != m.count)             ||
+        !close(m.x, both_x, both_x_abs)          ||
+        !close(m.yy, both_yy, both_yy)           ||
+        !close(m.xy, dot, dot_abs)               )  ++mismatches;
+
+    FloatSignal back;
+    mx.copy_to(back);
+    for (size_t i = 0; i < samples; ++i)
+    {
+        bool was = FloatType::is_valid(x.sample[i]);
+        if ((was != FloatType::is_valid(back.sample[i])) ||
+            (was && (x.sample[i].value != back.sample[i].value)))
+        {
+            ++mismatches;
+            break;
+        }
+    }
+    return mismatches;
+}
+
+
+// main
+//      Check the masked reductions (as built with the flags given)
+//      against plain loops over NaN's for missing samples, on lengths
+//      that do and don't fill the last lanes and words.
+//
+int main(int ac, char * av[])
+{
+    int rounds = 200;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "check_masked - Check the masked reductions against "
+                 "plain loops.")
+        ("rounds", po::value< int >(&rounds),
+         "Rounds of made up signals (default 200).")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(ac, av, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+
+    uint32_t state  = 1;
+    int      checks = 0;
+    int      mismatches = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        size_t samples = 1 + next_random(state) % 3000;
+        mismatches += check(samples, state);
+        checks     += 8;
+    }
+
+    ::printf("check_masked: %i lanes wide, %i of %i checks differed.\n",
+             FloatLanes::width, mismatches, checks);
+    return (0 == mismatches) ? 0 : 1;
+}
@@ -1,66 +1,366 @@
 #include "../include/constants.h"
 #include "../include/correlations.h"
+#include "../include/window_bank.h"
+#include "../include/ewma.h"
+#include "../include/day_rows.h"
 #include "../include/progress_bar.h"
 #include <boost/lexical_cast.hpp>
-#include <boost/filesystem.hpp>
+#include <boost/program_options.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind/bind.hpp>
+#include <fstream>
+#include <sstream>
 
 
 using namespace std;
+namespace po = boost::program_options;
+
+
+//  TenFiftyDay
+//      The 10- and 50-day correlations from the files preprocess
+//      always writes.
+//
+struct TenFiftyDay
+{
+    typedef FloatStatisticalDeque MeanDeque;
+    typedef FloatCorrelator       Correlator;
+    typedef FloatCrossCorrelation Slice;
+
+    //  load
+    //      Load a day's means.
+    //      dir      - means directory.
+    //      filename - means file name within it.
+    //
+    static bool load(MeanDeque& mean, const Directory& dir,
+                     const string& filename)
+    {
+        if (!load_from(mean, dir, filename))
+        {
+            cout << dir.path(filename)
+                 << " isn't a means file for this build." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    //  save
+    //      Save a day's slice.
+    //      dir      - results directory.
+    //      filename - results file name within it.
+    //      date     - date index.
+    //
+    static void save(Slice& slice, const Directory& dir,
+                     const string& filename, int date)
+    {
+        slice.save_to(dir, filename, date);
+    }
+
+    //  means_file
+    //      Name of the means file within a day's directory.
+    //
+    static string means_file() { return constants::corellating; }
+
+    //  results_file
+    //      Name of the cross correlations file for a date.
+    //
+    static string results_file(const string& sdate) { return sdate; }
+
+    //  resume
+    //      Pick up the state left in a day's results. Nothing
+    //      carries over from day to day here.
+    //
+    static bool resume(Slice&, const Directory&, const string&) { return true; }
+
+    //  carry_over
+    //      Line up what carries over from the day before with the
+    //      rows of the day just loaded. Nothing here either.
+    //
+    static void carry_over(Slice&) { }
+};
+
+
+//  PairwiseDays
+//      The 10- and 50-day correlations over just the days each pair
+//      both traded on (see MaskedCorrelator), from the same means as
+//      TenFiftyDay and the validity file preprocess writes next to
+//      them.
+//
+struct PairwiseDays
+{
+    typedef MaskedStatisticalDeque MeanDeque;
+    typedef FloatMaskedCorrelator  Correlator;
+    typedef FloatCrossCorrelation  Slice;
+
+    static bool load(MeanDeque& mean, const Directory& dir,
+                     const string& filename)
+    {
+        if (!TenFiftyDay::load(mean.data, dir, filename)) return false;
+
+        string validity = filename.substr(0, filename.rfind('/') + 1) +
+                          constants::window_validity;
+        if (!mean.valid.load(dir, validity) ||
+            (mean.valid.size() != mean.data.size()))
+        {
+            cout << dir.path(validity)
+                 << " is missing or doesn't match the means." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    static void save(Slice& slice, const Directory& dir,
+                     const string& filename, int date)
+    {
+        slice.save_to(dir, filename, date);
+    }
+
+    static string means_file() { return constants::corellating; }
+
+    static string results_file(const string& sdate)
+    {
+        return constants::pairwise_prefix + sdate;
+    }
+
+    static bool resume(Slice&, const Directory&, const string&) { return true; }
+
+    static void carry_over(Slice&) { }
+};
+
+
+//  WindowBankDays
+//      Any set of window lengths from the window bank
+//      (preprocess --window-bank). Both files carry the bank's
+//      window lengths up front.
+//
+struct WindowBankDays
+{
+    typedef FloatBankedStatisticalDeque MeanDeque;
+    typedef FloatBankedCorrelator       Correlator;
+    typedef FloatBankedCrossCorrelation Slice;
+
+    static bool load(MeanDeque& mean, const Directory& dir,
+                     const string& filename)
+    {
+        InFile in(dir, filename, ios_base::binary);
+        if (!load_window_header<FloatWindowBank::Lengths>(in))
+        {
+            cout << dir.path(filename)
+                 << " is from a different window bank." << endl;
+            return false;
+        }
+        if (!load_from(mean, in))
+        {
+            cout << dir.path(filename)
+                 << " isn't a means file for this build." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    static void save(Slice& slice, const Directory& dir,
+                     const string& filename, int date)
+    {
+        OutFile out(dir, filename, ios_base::binary);
+        save_window_header<FloatWindowBank::Lengths>(out);
+        slice.save_to(out, date);
+    }
+
+    static string means_file()
+    {
+        return constants::window_bank_prefix + constants::corellating;
+    }
+
+    static string results_file(const string& sdate)
+    {
+        return constants::window_bank_prefix + sdate;
+    }
+
+    static bool resume(Slice&, const Directory&, const string&) { return true; }
+
+    static void carry_over(Slice&) { }
+};
+
+
+//  EwmaDays
+//      Exponentially weighted correlations (preprocess --ewma).
+//      The slice holds every pair's covariance and lives for the
+//      whole run, each day moves it on by one update. Both files
+//      carry the half-lives up front; correlate uses whatever
+//      preprocess computed.
+//      The rows are every symbol preprocess had, which changes when
+//      it carries on with a new symbol list, so each day's rows and
+//      the slice's rows are kept by global id (see DayRows) and the
+//      covariances follow their symbols from one to the other. Only
+//      one EWMA day is correlated at a time, so the rows are shared.
+//
+struct EwmaDays
+{
+    typedef FloatEwmaStatisticalDeque MeanDeque;
+    typedef FloatEwmaCorrelator       Correlator;
+    typedef FloatEwmaCrossCorrelation Slice;
+
+    static bool load(MeanDeque& mean, const Directory& dir,
+                     const string& filename)
+    {
+        InFile in(dir, filename, ios_base::binary);
+        if (!EwmaHalfLives::load_header(in))
+        {
+            cout << dir.path(filename) << " has different half-lives." << endl;
+            return false;
+        }
+        if (!load_from(mean, in))
+        {
+            cout << dir.path(filename)
+                 << " isn't a means file for this build." << endl;
+            return false;
+        }
+
+        string rows = filename.substr(0, filename.rfind('/') + 1) +
+                      constants::ewma_rows;
+        if (!s_loaded.load(dir, rows) || (s_loaded.size() != mean.size()))
+        {
+            cout << dir.path(rows)
+                 << " is missing or doesn't match the means." << endl;
+            return false;
+        }
+        return true;
+    }
+
+    static void save(Slice& slice, const Directory& dir,
+                     const string& filename, int date)
+    {
+        OutFile out(dir, filename, ios_base::binary);
+        EwmaHalfLives::save_header(out);
+        slice.save_to(out, date);
+
+        s_rows.save(dir, filename + constants::day_rows_suffix);
+    }
+
+    static string means_file()
+    {
+        return constants::ewma_prefix + constants::corellating;
+    }
+
+    static string results_file(const string& sdate)
+    {
+        return constants::ewma_prefix + sdate;
+    }
+
+    //  resume
+    //      The last day's results hold all of the covariances, and
+    //      the rows they're for next to them. Results without their
+    //      rows can't be lined up with the means, so aren't resumed.
+    //
+    static bool resume(Slice& slice, const Directory& dir,
+                       const string& filename)
+    {
+        InFile in(dir, filename, ios_base::binary);
+        if (!EwmaHalfLives::load_header(in) || !slice.load_from(in))
+            return false;
+
+        bool rows = s_rows.load(dir, filename + constants::day_rows_suffix);
+        size_t pairs = (0 == s_rows.size()) ? 0
+                     : sum_first_n_numbers(s_rows.size() - 1);
+        if (!rows || (size_t(slice.size()) != pairs))
+        {
+            cout << dir.path(filename) << " has no rows to carry on from." << endl;
+            s_rows.clear();
+            return false;
+        }
+        return true;
+    }
+
+    //  carry_over
+    //      Move each pair's covariance from its place among the
+    //      slice's rows to its place among the rows just loaded. A
+    //      pair with a symbol that wasn't there starts over.
+    //
+    static void carry_over(Slice& slice)
+    {
+        if ((0 != s_rows.size()) && (s_rows.ids() != s_loaded.ids()))
+        {
+            cout << "The symbols changed, moving the covariances to "
+                 << "their new rows." << endl;
+
+            vector<Slice::CorrelationsType> carried(slice.size());
+            for (int i = 0; i < slice.size(); ++i) carried[i] = slice.at(i);
+
+            slice.size_for(s_loaded.size());
+            for (unsigned int row = 1; row < s_loaded.size(); ++row)
+            {
+                int from_row = s_rows.row(s_loaded.id(row));
+                for (unsigned int col = 0; col < row; ++col)
+                {
+                    int from_col = s_rows.row(s_loaded.id(col));
+
+                    Slice::CorrelationsType& c = slice.at(RowColPair(row, col));
+                    c = Slice::CorrelationsType();
+                    if ((0 > from_row) || (0 > from_col)) continue;
+
+                    unsigned int r = max(from_row, from_col);
+                    unsigned int k = min(from_row, from_col);
+                    c = carried[sum_first_n_numbers(r - 1) + k];
+                }
+            }
+        }
+        s_rows = s_loaded;
+    }
+
+protected:
+    //  s_rows
+    //  s_loaded
+    //      Global ids of the slice's rows, and of the day just loaded.
+    //
+    static DayRows s_rows;
+    static DayRows s_loaded;
+};
+
+DayRows EwmaDays::s_rows;
+DayRows EwmaDays::s_loaded;
 
 
 //  CorrelationsVisitor
 //      This represents a visitor on a particular element of
 //      the massive cross-correlations matrix.
 //      It will correlate a pair of statistical data elements.
+//      Days - TenFiftyDay, PairwiseDays, WindowBankDays or EwmaDays.
 //
+template<class Days>
 class CorrelationsVisitor
 {
-protected:
-    //  Statistical Data Storage
-    //
-    //  mean
-    //      Statistical data for a particular day.
+public:
+    //  Constructor
+    //      mean - the day's statistical data.
     //
-    static FloatStatisticalDeque _mean;
+    inline CorrelationsVisitor(const typename Days::MeanDeque& mean) :
+        _mean(mean) { }
 
-public:
     //  load_statistical_data
     //      Load up a day's worth of statistical data.
-    //      This will handle the directory traversal.
-    //      date - day to look up in all of the symbol directories.
+    //      date - day to look up in the means directory.
+    //      mean - statistical data out.
     //
-    static bool load_statistical_data(const DateIndex::IndexType date)
+    static bool load_statistical_data(const DateIndex::IndexType date,
+                                      typename Days::MeanDeque&  mean)
     {
-        cout << "Loading data for day " << date << "..." << endl;
+        ::printf("Loading data for day %i...\n", int(date));
 
-        // Change directories into the lists directory.
-        WorkingDirectory current_dir(constants::means_path.base_path());
         string filename = boost::lexical_cast<string>(date);
         filename += '/';
-        filename += constants::corellating;
+        filename += Days::means_file();
         
-        if(boost::filesystem::exists(filename))
-        {
-            load_from(_mean, filename.c_str());
-            return true;
-        }
+        if(constants::means_dir.exists(filename))
+            return Days::load(mean, constants::means_dir, filename);
         else
             return false;
     }
 
-    //  size
-    //      Return the number of elements in the
-    //      statistical data set for a particular day.
-    //      Used to resize the cross correlations set.
-    //
-    static unsigned int size() { return _mean.size(); }
-
     //  Cross Correlation
     //
     //  correlator
     //      Memory and functionality used to correlate two elements.
     //
-    FloatCorrelator correlator;
+    typename Days::Correlator correlator;
     
     //  operator()
     //      Cross correlate a pair of means. Called by ThreadMain.
@@ -68,50 +368,85 @@ public:
     //      corrs    - output correlations.
     //
     void operator()(const RowColPair& rc,
-                    FloatCrossCorrelation::CorrelationsRef corrs)
+                    typename Days::Slice::CorrelationsRef corrs)
     {
         if((_mean.size() > rc.row) && (_mean.size() > rc.col))
             correlator.compute(corrs, _mean[rc.row], _mean[rc.col]);
     }
-    
+
+protected:
+    //  _mean
+    //      Statistical data for a particular day.
+    //
+    const typename Days::MeanDeque& _mean;
 };
-FloatStatisticalDeque CorrelationsVisitor::_mean;
 
 
 //  CorrelationsThread
-//      Contain the cross-correlations set and act as thread main.
+//      Contain a day's statistical data and cross-correlations set,
+//      and act as thread main for the threads correlating it.
+//      Each one owns its state, so several days can be in flight.
+//      Days - TenFiftyDay, PairwiseDays, WindowBankDays or EwmaDays.
 //
+template<class Days>
 class CorrelationsThread
 {
 protected:
+    typedef CorrelationsVisitor<Days> Visitor;
+
+    //  _mean
+    //      The day's statistical data.
+    //
+    typename Days::MeanDeque _mean;
+
     //  _correlation
     //      This is a day's slice.
     //
-    static FloatCrossCorrelation _correlation;
+    typename Days::Slice _correlation;
     
     //  _progress_bar
     //      Give the user a little feedback...
     //
-    static ProgressBar _progress_bar;
+    ProgressBar _progress_bar;
 
     //  _date
     //      Current date being corellated.
     //
-    static DateIndex::IndexType _date;
+    DateIndex::IndexType _date;
+
+    //  _quiet
+    //      Running alongside other days: no progress bar.
+    //
+    bool _quiet;
     
 public:
-    //  set_size
+    //  Constructor
+    //
+    inline CorrelationsThread() : _date(-1), _quiet(false) { }
+
+    //  quiet
+    //      Don't draw a progress bar, for running several days at once.
+    //
+    inline void quiet()
+    {
+        _quiet = true;
+        _progress_bar.hide();
+    }
+
+    //  initialize_day
     //      Set up the slice to hold a day's worth of
     //      cross-correlations.
-    static bool initialize_day(const DateIndex::IndexType date)
+    //
+    bool initialize_day(const DateIndex::IndexType date)
     {
         _date = date;
 
-        bool data_loaded = CorrelationsVisitor::load_statistical_data(date);
+        bool data_loaded = Visitor::load_statistical_data(date, _mean);
 
         if (data_loaded)
         {
-            _correlation.size_for(CorrelationsVisitor::size());
+            Days::carry_over(_correlation);
+            _correlation.size_for(_mean.size());
 
             string banner = "Cross corellating day ";
             banner += boost::lexical_cast<string>(_date);
@@ -121,77 +456,348 @@ public:
         }
         else
         {
-            cout << "Skipping day " << date << " - no data." << endl;
+            ::printf("Skipping day %i - no data.\n", int(date));
         }
 
         return data_loaded;
     }
     
+    //  last_saved
+    //      Find the last day with results on disk.
+    //      Returns DateIndex::first() - 1 if there are none.
+    //
+    static DateIndex::IndexType last_saved()
+    {
+        DateIndex::IndexType idate = DateIndex::last();
+        for (; DateIndex::first() <= idate; --idate)
+        {
+            string sdate = Days::results_file(
+                boost::lexical_cast<string>(idate));
+            if (constants::correlations_dir.exists(sdate)) break;
+        }
+        return idate;
+    }
+
+    //  resume
+    //      Pick up where the results of a day left off.
+    //      date - the day to continue from.
+    //
+    bool resume(const DateIndex::IndexType date)
+    {
+        string sdate = Days::results_file(boost::lexical_cast<string>(date));
+        return Days::resume(_correlation, constants::correlations_dir, sdate);
+    }
+
+    //  correlate
+    //      Correlate the day on a group of threads.
+    //      threads - number of threads.
+    //
+    void correlate(int threads)
+    {
+        boost::thread_group workers;
+        for (int i = 0; i < threads; i++)
+            workers.create_thread(boost::bind(&CorrelationsThread::work, this));
+        workers.join_all();
+    }
+
     //  save_results
     //      Save the results of a cross-correlation to disk.
-    //      date - specify the date index for an easy file name.
     //
-    static void save_results()
+    void save_results()
     {
-        // Change directories into the correlations directory.
-        WorkingDirectory current_dir(constants::correlations_path.base_path());
-
-        string sdate = boost::lexical_cast<string>(_date);
+        string sdate = Days::results_file(
+            boost::lexical_cast<string>(_date));
 
-        cout << "\nSaving cross correlations to " 
-             << constants::correlations_path.base_path() 
-             << '/' << sdate << '.' << endl;
-        _correlation.save_to(sdate.c_str());
+        ::printf("%sSaving cross correlations to %s.\n",
+                 _quiet ? "" : "\n",
+                 constants::correlations_dir.path(sdate).c_str());
+        Days::save(_correlation, constants::correlations_dir, sdate, _date);
     }
     
-    //  opertator()
+protected:
+    //  work
     //      This is thread main. Get an element to visit.
     //      Corellate the element (it's a pair of statistical
     //      data structures). If the element corellates over
     //      50 days, add it to the set of corellated elements.
     //      Increment the progress bar.
     //
-    void operator()()
+    void work()
     {
-        CorrelationsVisitor v; // is for Victory! Vandetta!
-                               // And creepy snake aliens!
+        Visitor v(_mean); // is for Victory! Vandetta!
+                          // And creepy snake aliens!
 
-        FloatCrossCorrelation::Element visited;
+        typename Days::Slice::Element visited;
 
         while(_correlation.get_next_element(visited))
         {
             _correlation.visit_element(visited, v);
             _progress_bar.increment();
-            boost::this_thread::yield();
         }
     }
+
+private:
+    //  Do Not Copy
+    //
+    CorrelationsThread(const CorrelationsThread&);
+    CorrelationsThread& operator=(const CorrelationsThread&);
 };
-FloatCrossCorrelation CorrelationsThread::_correlation;
-ProgressBar           CorrelationsThread::_progress_bar;
-DateIndex::IndexType  CorrelationsThread::_date;
+
+
+//  DayRunner
+//      Thread main for correlating several days at once. Each runner
+//      owns a CorrelationsThread and takes the next day from a shared
+//      counter until there are none left.
+//      Days - TenFiftyDay, PairwiseDays or WindowBankDays. EWMA days
+//             carry on from one day to the next, so they can't overlap.
+//
+template<class Days>
+class DayRunner
+{
+public:
+    //  Constructor
+    //      next    - next date to correlate, shared by the runners.
+    //      threads - threads to correlate each day with.
+    //
+    inline DayRunner(boost::atomic<int>& next, int threads) :
+        _next(next), _threads(threads) { }
+
+    //  operator()
+    //      Thread main.
+    //
+    void operator()()
+    {
+        CorrelationsThread<Days> day;
+        day.quiet();
+
+        for (int idate = _next++; DateIndex::last() >= idate; idate = _next++)
+        {
+            if (day.initialize_day(idate))
+            {
+                day.correlate(_threads);
+                day.save_results();
+            }
+        }
+    }
+
+protected:
+    boost::atomic<int>& _next;
+    int                 _threads;
+};
+
+
+//  correlate_all_days
+//      Run the cross correlation for every date with data.
+//      Days            - TenFiftyDay, PairwiseDays, WindowBankDays or
+//                        EwmaDays.
+//      append          - start after the last day already saved.
+//      days_at_once    - number of days in flight.
+//      threads_per_day - threads correlating each day.
+//
+template<class Days>
+bool correlate_all_days(bool append, int days_at_once, int threads_per_day)
+{
+    DateIndex::IndexType first = DateIndex::first();
+    CorrelationsThread<Days> day;
+
+    if (append)
+    {
+        DateIndex::IndexType last = CorrelationsThread<Days>::last_saved();
+        if (DateIndex::first() <= last)
+        {
+            if (!day.resume(last))
+            {
+                cout << "Can't resume from day " << last << "." << endl;
+                return false;
+            }
+            cout << "Appending from day " << last + 1 << "." << endl;
+            first = last + 1;
+        }
+    }
+
+    if (1 < days_at_once)
+    {
+        cout << "Correlating " << days_at_once << " days at once, "
+             << threads_per_day << " threads each." << endl;
+
+        boost::atomic<int> next(first);
+        boost::thread_group runners;
+        for (int i = 0; i < days_at_once; i++)
+            runners.create_thread(DayRunner<Days>(next, threads_per_day));
+        runners.join_all();
+        return true;
+    }
+
+    for (DateIndex::IndexType idate = first;
+         DateIndex::last() >= idate;
+         ++idate)
+    {
+        if(day.initialize_day(idate))
+        {
+            day.correlate(threads_per_day);
+            day.save_results();
+        }
+    }
+    return true;
+}
+
+
+//  window_mask
+//      Turn a comma separated list of window lengths into the
+//      window bank selection mask. Returns 0 for an unknown length.
+//
+unsigned int window_mask(const string& windows)
+{
+    unsigned int mask = 0;
+
+    istringstream in(windows);
+    string length;
+    while (getline(in, length, ','))
+    {
+        int index = -1;
+        try
+        {
+            index = FloatWindowBank::Lengths::index_of(
+                boost::lexical_cast<int>(length));
+        }
+        catch (boost::bad_lexical_cast&) { }
+
+        if (0 > index)
+        {
+            cout << "Window length " << length
+                 << " is not in the window bank." << endl;
+            return 0;
+        }
+        mask |= (1u << index);
+    }
+    return mask;
+}
 
 
 //  main
 //      Main function that'll do a bunch of correlation.
-//      argc - argument count (ignored)
-//      argb - arguments      (ignored)
+//      argc - argument count
+//      argv - arguments
 //
 int main (int argc, char * argv[])
 {
-    for (DateIndex::IndexType idate = DateIndex::first();
-         DateIndex::last() >= idate;
-         ++idate)
+    string windows;
+    int    days_at_once;
+    int    threads_per_day;
+    double min_overlap;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "correlate - Cross correlate every pair of symbols, "
+                 "every day.")
+        ("window-bank",
+         "Correlate the window bank written by preprocess --window-bank "
+         "instead of the 10- and 50-day averages. "
+         "Writes bank.<date> files.")
+        ("windows", po::value< string >(&windows),
+         "Window lengths to correlate with --window-bank, "
+         "eg. --windows=5,20,250. Default is all of them.")
+        ("ewma",
+         "Correlate the exponentially weighted averages written by "
+         "preprocess --ewma. Writes ewma.<date> files, which also hold "
+         "each pair's running covariance.")
+        ("pairwise",
+         "Correlate each pair over just the days both symbols traded "
+         "on, instead of counting the days either missed as no change. "
+         "Needs the validity files preprocess writes. "
+         "Writes pairwise.<date> files.")
+        ("min-overlap", po::value< double >(&min_overlap)->default_value(0.5),
+         "With --pairwise, the fraction of each window two symbols "
+         "must share (at least 3 days) to be correlated.")
+        ("append",
+         "Start after the last day already in the correlations "
+         "directory (and carry on its covariances with --ewma).")
+        ("days-at-once", po::value< int >(&days_at_once)->default_value(1),
+         "Correlate this many days at the same time. Helps keep the "
+         "cores busy when there are few symbols; each day in flight "
+         "holds its own slice in memory. Not with --ewma.")
+        ("threads-per-day", po::value< int >(&threads_per_day),
+         "Threads correlating each day. Default is the number of "
+         "cores split between the days at once.")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+
+    bool append = (0 != vm.count("append"));
+    bool ok;
+
+    if (1 > days_at_once)
+    {
+        cout << "Bad --days-at-once: " << days_at_once << endl;
+        return 1;
+    }
+
+    if (vm.count("threads-per-day"))
     {
-        if(CorrelationsThread::initialize_day(idate))
+        if (1 > threads_per_day)
         {
-            boost::thread_group workers;
-            for (int i = 0; i < boost::thread::hardware_concurrency(); i++)
-                workers.create_thread(CorrelationsThread());
-            workers.join_all();
+            cout << "Bad --threads-per-day: " << threads_per_day << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        threads_per_day = boost::thread::hardware_concurrency() / days_at_once;
+        if (1 > threads_per_day) threads_per_day = 1;
+    }
 
-            CorrelationsThread::save_results();
+    // Each mode writes its own correlations, so only one at a time.
+    if (1 < vm.count("ewma") + vm.count("pairwise") + vm.count("window-bank"))
+    {
+        cout << "Only one of --ewma, --pairwise and --window-bank at a time." << endl;
+        return 1;
+    }
+
+    if (vm.count("ewma"))
+    {
+        // Each day's covariances carry on from the day before.
+        if (1 < days_at_once)
+        {
+            cout << "--days-at-once doesn't work with --ewma." << endl;
+            return 1;
         }
+        ok = correlate_all_days<EwmaDays>(append, 1, threads_per_day);
+    }
+    else if (vm.count("pairwise"))
+    {
+        if ((0.0 >= min_overlap) || (1.0 < min_overlap))
+        {
+            cout << "Bad --min-overlap: " << min_overlap << endl;
+            return 1;
+        }
+        FloatMaskedCorrelator::min_overlap(min_overlap);
+
+        ok = correlate_all_days<PairwiseDays>(append, days_at_once,
+                                              threads_per_day);
+    }
+    else if (vm.count("window-bank"))
+    {
+        if (!windows.empty())
+        {
+            unsigned int mask = window_mask(windows);
+            if (0 == mask) return 1;
+            FloatBankedCorrelator::select(mask);
+        }
+
+        ok = correlate_all_days<WindowBankDays>(append, days_at_once,
+                                                threads_per_day);
     }
+    else
+        ok = correlate_all_days<TenFiftyDay>(append, days_at_once,
+                                             threads_per_day);
     
-    return 0;
+    return ok ? 0 : 1;
 }
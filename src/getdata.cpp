@@ -8,24 +8,97 @@
 #include "../include/symbols.h"
 #include "../include/parsers.h"
 #include "../include/signals.h"
-#include <boost/filesystem.hpp>
+#include "../include/masked_signal.h"
+#include "../include/tick_store.h"
+#include <boost/thread.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
 
+namespace po = boost::program_options;
 using namespace std;
 using namespace boost::gregorian;
 
+//  BackgroundSums
+//      Sums and counts of the relative changes of the ticks on each
+//      date. Workers each keep their own and they are merged at the
+//      end, so nothing is shared while the ticks are read.
+//      bkg   - sums of the changes; a date is there once a change
+//              that isn't NaN is added.
+//      count - ticks on each date, with or without a change.
+//
+struct BackgroundSums
+{
+    MaskedSignal  bkg;
+    vector<float> count;
+
+    inline BackgroundSums() :
+        bkg(DateIndex::interval()), count(DateIndex::interval(), 0.0f) { }
+
+    inline void update_bkg(DateIndex::IndexType i,
+                           float                datum)
+    {
+        bkg.add(i, datum);
+        count[i] += 1.0f;
+    }
+
+    //  add_ticks
+    //      Add the relative change of each of a symbol's ticks to the
+    //      sums, newest first, the order they are in the CSV file.
+    //      ts - the ticks, oldest first.
+    //
+    void add_ticks(const TickerSet& ts)
+    {
+        for (int j = int(ts.size()) - 2; 0 <= j; --j)
+            update_bkg(ts[j].index,
+                       ts[j].value.inverse_delta_close(ts[j + 1].value));
+    }
+
+    //  merge
+    //      Add another set of sums to these. Dates with nothing in
+    //      them hold 0 and add nothing, without a test.
+    //      part - the other sums.
+    //
+    void merge(const BackgroundSums& part)
+    {
+        bkg += part.bkg;
+        for(int i = 0; i < DateIndex::interval(); i++)
+            count[i] += part.count[i];
+    }
+
+    //  means
+    //      The mean change of each date with one, NaN for the others.
+    //      mean - signal to fill.
+    //
+    void means(FloatSignal& mean) const
+    {
+        mean.sample.assign(DateIndex::interval(), FloatType());
+        for(int i = 0; i < DateIndex::interval(); i++)
+            if (bkg.is_valid(i) && (0.0f < count[i]))
+                mean.sample[i] = bkg.value[i] / count[i];
+    }
+};
+
+
 //  Backgrounder
 //      Handle the background collection and application to the ticks.
 //
 class Backgrounder
 {
 public:
-    static void update_bkg(DateIndex::IndexType i,
-                           float                datum)
-    {
-        bkg.sample[i] += datum;
-        count.sample[i] += 1;
-    }
+    //  add_ticks
+    //      Add a symbol's ticks to the background.
+    //      ts - the ticks, oldest first.
+    //
+    static void add_ticks(const TickerSet& ts) { sums.add_ticks(ts); }
+
+    //  merge
+    //      Add a worker's sums to the background.
+    //      part - its sums.
+    //
+    static void merge(const BackgroundSums& part) { sums.merge(part); }
 
     //  record_backgrounds
     //      Compute the mean background relative change for each date in the
@@ -35,59 +108,129 @@ public:
     {
         // Compute mean background values.
         //
-        for(int i = 0; i < DateIndex::interval(); i++)
-            if (0 < count.sample[i]) 
-                bkg.sample[i] /= count.sample[i];
+        sums.means(background);
         
-        // Write to current directory.
+        // Write to the data directory.
         //
-        bkg.save_to("background.dat");
+        background.save_to(constants::data_dir, "background.dat");
     }
 
-    //  operator()
-    //      Load up the ticks for a Symbol and apply the background to its close
-    //      values. Used in a foreach loop.
-    //      sd - Current symbol for processing.
+    //  apply_all
+    //      Apply the background to the ticks of every symbol,
+    //      several symbols at a time.
+    //      symbols - the list.
+    //      threads - symbols to work on at once.
     //
-    inline void operator()(const SymbolDescriptor& sd)
+    static void apply_all(const SymbolDescriptorSet& symbols, int threads)
+    {
+        vector<const SymbolDescriptor *> list;
+        BOOST_FOREACH(const SymbolDescriptor& sd, symbols)
+        {
+            list.push_back(&sd);
+        }
+
+        if (threads > int(list.size())) threads = list.size();
+        if (1 > threads) threads = 1;
+
+        boost::atomic<size_t> next(0);
+        boost::thread_group   workers;
+        for (int i = 0; i < threads; i++)
+            workers.create_thread(boost::bind(&Backgrounder::apply_worker,
+                                              boost::cref(list),
+                                              boost::ref(next)));
+        workers.join_all();
+    }
+
+    //  apply
+    //      Load up the ticks for a Symbol and apply the background to
+    //      its close values.
+    //      sd    - Current symbol for processing.
+    //      ticks - buffer for its ticks.
+    //
+    static void apply(const SymbolDescriptor& sd, TickerSet& ticks)
     {
-        static TickerSet ticks;
         ticks.clear();
-        load_from(ticks, sd.DATFile.c_str());
+        load_from(ticks, constants::data_dir, sd.DATFile);
+        apply(ticks);
+        save_to(ticks, constants::data_dir, sd.DATFile);
+        add_to_store(sd, ticks);
+    }
 
+    //  apply
+    //      Apply the background to ticks in memory.
+    //      ticks - a symbol's ticks.
+    //
+    static void apply(TickerSet& ticks)
+    {
         BOOST_FOREACH(Ticker& t, ticks)
         {
-            t.value.apply_inv_delta(bkg.sample[t.index]);
+            t.value.apply_inv_delta(background.sample[t.index]);
         }
+    }
 
-        save_to(ticks, sd.DATFile.c_str());
+    //  add_to_store
+    //      Record a symbol's corrected closes for the tick store.
+    //      sd    - the symbol.
+    //      ticks - its ticks.
+    //
+    static void add_to_store(const SymbolDescriptor& sd,
+                             const TickerSet&        ticks)
+    {
+        boost::lock_guard<boost::mutex> lock(store_mutex);
+        store.add(sd.Symbol, ticks);
+    }
+
+    //  record_store
+    //      Write the corrected closes of every symbol into the
+    //      tick store, in the order of the final list.
+    //      symbols - the final list.
+    //
+    static bool record_store(const SymbolDescriptorSet& symbols)
+    {
+        return store.save(symbols, constants::data_dir, constants::tick_store);
     }
 
 protected:
-    static FloatSignal count;
-    static FloatSignal bkg;
+    //  apply_worker
+    //      Thread Main for apply_all. Take the next symbol and apply
+    //      the background to it until there are none left.
+    //
+    static void apply_worker(const vector<const SymbolDescriptor *>& list,
+                             boost::atomic<size_t>&                  next)
+    {
+        TickerSet ticks;
+        for (size_t i = next++; i < list.size(); i = next++)
+            apply(*list[i], ticks);
+    }
+
+    //  sums
+    //  background
+    //      The background: sums and counts, then the means.
+    //
+    static BackgroundSums sums;
+    static FloatSignal    background;
+
+    static TickStoreWriter store;
+    static boost::mutex    store_mutex;
 
 };
-FloatSignal Backgrounder::count;
-FloatSignal Backgrounder::bkg;
+BackgroundSums Backgrounder::sums;
+FloatSignal Backgrounder::background;
+TickStoreWriter Backgrounder::store;
+boost::mutex Backgrounder::store_mutex;
 
 // YahooCSVParser
 //      Parse a Yahoo! CSV line and add it to a set.
-//      Might throw a bad_lexical_cast or something...
 //
 class YahooCSVParser
 {
 public:
     //  operator()
     //      Parses a line of a Yahoo! CSV file.
-    //      Also constructs a background of relative changes.
     //
-    void operator()(const stringvector& elements, TickerSet& ts)
+    void operator()(const fieldvector& elements, TickerSet& ts)
     {
         if( elements.size() < 7) return;
-    
-        static SafeLexicalCast<float, string> to_float(0.0);
-        static SafeLexicalCast<long, string> to_long(-1);
 
         // 0 = Date      - parse into DateIndex
         // 1 = Open      - parse into float
@@ -98,24 +241,22 @@ public:
         // 6 = Adj Close - parse into float
 
         DateIndex::IndexType i = DateIndex::from_string(elements[0]);
-        FloatType fclose = to_float.cast(elements[6]) * 100.0;
+
+        // An adj close that doesn't read is taken as 0, one that
+        // doesn't convert is left invalid (-1).
+        float adj_close = 0.0;
+        parse_field(elements[6], adj_close);
+
+        long pennies;
+        dollars_to_pennies(adj_close, pennies);
 
         // construct a Ticker
         Ticker t(
-            i,                                                  // date index.
-            Tick(float_type_to_int_type<float, long>(fclose))); // adj close
-                                                                // (pennies)
+            i,                  // date index.
+            Tick(pennies));     // adj close (pennies)
 
         // and push it onto the front of a list.
         ts.push_front(t);
-
-        // If there's a previous element, diff it with this one.
-        if (1 < ts.size())
-        {
-            Backgrounder::update_bkg(i,
-                ts[0].value.inverse_delta_close(ts[1].value));
-        }
-
     }
     
 protected:
@@ -123,9 +264,8 @@ protected:
 
 //  Snarf
 //      Wrap up some calls to shell scripts that
-//      in turn call snarf.
-//      Implemented as a function object to optimize
-//      construction of commandline:
+//      in turn call snarf. Fetches CSV files for an Ingester
+//      from the network with the commandline:
 // sh ../bin/snarf-YF-table.sh MSFT 08 22 2010 08 22 2011
 //      using a couple of constants.
 //
@@ -137,87 +277,52 @@ public:
     //
     inline Snarf() { }
 
-    // Copy Constructor
-    //      BOOST_FOREACH will make a copy of this class
-    //      for each element of the Symbol set.
+    //  directory
+    //      Where the fetched CSV files are.
     //
-    inline Snarf(const Snarf& sayft) {}
-
-    // operator()
-    //      Use one of these like a function in a BOOST_FOREACH loop.
-    //      Will WGet a Yahoo! Finance Historical Data CSV file for
-    //      a particluar Ticker Symbol, pre-process it into a DAT file
-    //      extracting a background of mean relative changes, and
-    //      delete the downloaded CSV file.
-    //      sd - SymbolDescriptor to act on.
+    inline const Directory& directory() const { return constants::data_dir; }
+
+    // fetch
+    //      WGet a Yahoo! Finance Historical Data CSV file for a
+    //      particluar Ticker Symbol into the data directory.
+    //      sd - SymbolDescriptor to fetch.
+    //      returns true if there's a file with something in it; an
+    //      empty one is deleted.
     //
-    inline void operator()(const SymbolDescriptor& sd)
+    inline bool fetch(const SymbolDescriptor& sd)
     {
-        // buffer...
-        static string command;
-        command.clear();
-
-        command += s_command_base;
+        string command(s_command_base);
         command += sd.Symbol;
         command += s_dates;
-       
+
         // debugging...
         // ::puts(command.c_str());
 
         ::system(command.c_str());
-        
-        // Might consider spinning off a thread to do the preprocessing while
-        // the next file is downloaded...
-        // join previous thread.
-        // adjust thread parameters
-        // and spin it off while downloading the next one...
-        
-        // begin should be threaded stuff
+
+        const Directory& data_dir = constants::data_dir;
 
         // if a file was downloaded...
-        if(boost::filesystem::exists(sd.CSVFile))
+        if (!data_dir.exists(sd.CSVFile)) return false;
+
+        // delete it if empty
+        if (0 == data_dir.file_size(sd.CSVFile))
         {
-            if (boost::filesystem::is_empty(sd.CSVFile))
-            {
-                // delete it if empty
-                boost::filesystem::remove(sd.CSVFile);
-            }
-            else
-            {
-                // preprocess it into a ticker file and save it.
-                static TickerSet ticks;
-                ticks.clear();
-
-                FileParser(sd.CSVFile.c_str(),
-                           ",").load_using(Snarf::yahoo_csv, ticks);
-                boost::filesystem::create_directory(sd.Symbol);
-                save_to(ticks, sd.DATFile.c_str());
-                boost::filesystem::remove(sd.CSVFile);
-                
-                // Make a date index map to the data...
-                static IntSignal datemap;
-                BOOST_FOREACH(IntType& i, datemap.sample)
-                {
-                    i = IntType::invalid_value;
-                }
-                
-                for(int j = 0; j < ticks.size(); j++)
-                {
-                    datemap.sample[ticks[j].index] = j;
-                }
-                
-                static string datemapfilename;
-                datemapfilename.clear();
-                datemapfilename = sd.Symbol;
-                datemapfilename += "/index";
-                
-                datemap.save_to(datemapfilename.c_str());
-            }
+            data_dir.remove(sd.CSVFile);
+            return false;
         }
-        
-        // end should be threaded stuff.
+        return true;
     }
-    
+
+    // release
+    //      Done with a symbol's CSV file: delete it.
+    //      sd - SymbolDescriptor fetched.
+    //
+    inline void release(const SymbolDescriptor& sd)
+    {
+        constants::data_dir.remove(sd.CSVFile);
+    }
+
     //  set_start_and_end
     //      Construct a string representing the start and end dates
     //      Note that months are 0 indexed... this is 22 Sept. 2010 --> 22 Sept. 2011
@@ -238,45 +343,377 @@ public:
     }
     
     //  up_some_lists
-    //      Snarf up the lists from nasdaq and finviz.
+    //      Snarf up the lists from nasdaq and finviz
+    //      into the lists directory.
     //
     static inline void up_some_lists()
     {
-        ::system("sh ../bin/snarflists.sh");
+        string command("cd ");
+        command += constants::lists_path.base_path();
+        command += " && sh ../bin/snarflists.sh";
+        ::system(command.c_str());
     }
     
 protected:
-    static YahooCSVParser yahoo_csv;
-    // Add boost::thread here...
-
     // constant parts of the commandline.
     static string s_dates;
     static const string s_command_base;
 };
-YahooCSVParser Snarf::yahoo_csv;
 string Snarf::s_dates;
-const string Snarf::s_command_base("sh ../bin/wget-YF-table.sh ");
+// The script downloads into the working directory, so it runs
+// from the data directory.
+const string Snarf::s_command_base(string("cd ") +
+                                   constants::data_path.base_path() +
+                                   " && sh ../bin/wget-YF-table.sh ");
+
 
+//  Mirror
+//      Fetch CSV files for an Ingester from a local directory of
+//      earlier downloads, <directory>/<Symbol>.csv, in place of the
+//      network. Nothing is copied or deleted.
+//
+class Mirror
+{
+public:
+    // Constructor
+    //      path - the directory.
+    //
+    inline Mirror(const char * path) : _dir(path) { }
+
+    inline bool is_open() const { return _dir.is_open(); }
+
+    //  directory
+    //      Where the CSV files are.
+    //
+    inline const Directory& directory() const { return _dir; }
 
-const string& clean_up_symbol(const string& symbol)
+    // fetch
+    //      sd - SymbolDescriptor to fetch.
+    //      returns true if there's a file with something in it.
+    //
+    inline bool fetch(const SymbolDescriptor& sd)
+    {
+        return (0 < _dir.file_size(sd.CSVFile));
+    }
+
+    // release
+    //      Leave the file be.
+    //
+    inline void release(const SymbolDescriptor&) { }
+
+protected:
+    Directory _dir;
+};
+
+
+//  Ingester
+//      Turn the CSV file of each symbol into a ticker file and a date
+//      map in the data directory, several symbols at a time, adding
+//      to the background as it goes. Workers take the list a chunk
+//      of s_chunk symbols at a time and sum each chunk's background
+//      on its own; the chunks are merged in order at the end, so the
+//      background is the same however many threads there are.
+//
+//      With keep_resident, the ticks stay in memory instead of being
+//      written, and write_resident applies the background and writes
+//      each symbol once, rather than Backgrounder::apply_all reading
+//      and rewriting every ticker file.
+//
+//      Fetcher - where the CSV files come from (Snarf, Mirror):
+//          const Directory& directory() const;
+//          bool fetch(const SymbolDescriptor& sd);
+//          void release(const SymbolDescriptor& sd);
+//
+template<class Fetcher>
+class Ingester
 {
-    static string stemp;
-    stemp.clear();
-    
-    stemp = boost::replace_first_copy(symbol, "$", "-P");
-    
-    static string stemptwo;
-    stemptwo.clear();
-    
-    stemptwo = boost::replace_first_copy(stemp, ".", "-");
-    
-    return stemptwo;
+public:
+    // Constructor
+    //      fetcher - gets the CSV files.
+    //      threads - symbols to work on at once.
+    //
+    inline Ingester(Fetcher& fetcher, int threads) :
+        _fetcher(fetcher),
+        _threads(threads),
+        _resident(false),
+        _next(0),
+        _ingested(0),
+        _bytes(0) { }
+
+    //  keep_resident
+    //      Keep the ticks in memory for write_resident. Call before
+    //      run.
+    //
+    inline void keep_resident() { _resident = true; }
+
+    //  run
+    //      Ingest every symbol, _threads at a time.
+    //      symbols - the list.
+    //
+    void run(const SymbolDescriptorSet& symbols)
+    {
+        boost::posix_time::ptime start(
+            boost::posix_time::microsec_clock::universal_time());
+
+        _symbols.clear();
+        BOOST_FOREACH(const SymbolDescriptor& sd, symbols)
+        {
+            _symbols.push_back(&sd);
+        }
+        _next     = 0;
+        _ingested = 0;
+        _bytes    = 0;
+        _sums.clear();
+        _sums.resize((_symbols.size() + s_chunk - 1) / s_chunk);
+        _ticks.clear();
+        _parsed.assign(_symbols.size(), false);
+        if (_resident) _ticks.resize(_symbols.size());
+
+        boost::thread_group workers;
+        for (int i = 0; i < threads_for(_sums.size()); i++)
+            workers.create_thread(boost::bind(&Ingester::work, this));
+        workers.join_all();
+
+        BOOST_FOREACH(const BackgroundSums& part, _sums)
+        {
+            Backgrounder::merge(part);
+        }
+        _sums.clear();
+
+        double mb = _bytes / (1024.0 * 1024.0);
+        double seconds = seconds_since(start);
+        ::printf("Ingested %i of %i symbols, %.1f MB of CSV in %.3f s (%.1f MB/s).\n",
+                 int(_ingested), int(_symbols.size()), mb, seconds,
+                 (0.0 < seconds) ? (mb / seconds) : 0.0);
+    }
+
+    //  write_resident
+    //      Apply the recorded background to the ticks kept by run
+    //      and write each symbol's ticker file, date map and tick
+    //      store row, _threads at a time.
+    //
+    void write_resident()
+    {
+        boost::posix_time::ptime start(
+            boost::posix_time::microsec_clock::universal_time());
+
+        _next = 0;
+        boost::thread_group workers;
+        for (int i = 0; i < threads_for(_symbols.size()); i++)
+            workers.create_thread(boost::bind(&Ingester::write_work, this));
+        workers.join_all();
+
+        _ticks.clear();
+        ::printf("Wrote %i symbols in %.3f s.\n",
+                 int(_ingested), seconds_since(start));
+    }
+
+    //  ingest
+    //      Fetch, parse and save one symbol and add it to the
+    //      background.
+    //      sd - SymbolDescriptor to act on.
+    //
+    void ingest(const SymbolDescriptor& sd)
+    {
+        TickerSet ticks;
+        if (parse(sd, ticks))
+        {
+            save(sd, ticks);
+            Backgrounder::add_ticks(ticks);
+        }
+    }
+
+    //  parse
+    //      Fetch a symbol's CSV file and parse it. Safe to call from
+    //      several threads at once.
+    //      sd    - SymbolDescriptor to act on.
+    //      ticks - its ticks.
+    //      returns false if there was no file.
+    //
+    bool parse(const SymbolDescriptor& sd, TickerSet& ticks)
+    {
+        if (!_fetcher.fetch(sd)) return false;
+
+        off_t bytes = _fetcher.directory().file_size(sd.CSVFile);
+        if (0 < bytes) _bytes += bytes;
+
+        YahooCSVParser yahoo_csv;
+        MappedFileParser(_fetcher.directory(), sd.CSVFile,
+                         ",").load_using(yahoo_csv, ticks);
+        _fetcher.release(sd);
+
+        ++_ingested;
+        return true;
+    }
+
+    //  save
+    //      Save a symbol's ticks into a ticker file, with a date map.
+    //      sd    - the symbol.
+    //      ticks - its ticks.
+    //
+    static void save(const SymbolDescriptor& sd, const TickerSet& ticks)
+    {
+        const Directory& data_dir = constants::data_dir;
+        data_dir.make_directory(sd.Symbol);
+        save_to(ticks, data_dir, sd.DATFile);
+        save_date_map(sd, ticks);
+    }
+
+    //  save_date_map
+    //      Make a date index map to a symbol's ticks and save it
+    //      next to them.
+    //      sd    - the symbol.
+    //      ticks - its ticks.
+    //
+    static void save_date_map(const SymbolDescriptor& sd,
+                              const TickerSet&        ticks)
+    {
+        IntSignal datemap;
+        for(size_t j = 0; j < ticks.size(); j++)
+        {
+            datemap.sample[ticks[j].index] = j;
+        }
+
+        datemap.save_to(constants::data_dir, sd.Symbol + "/index");
+    }
+
+protected:
+    //  work
+    //      Thread Main for run. Take the next chunk of symbols and
+    //      parse them into the chunk's sums, saving them or keeping
+    //      them, until there are none left.
+    //
+    void work()
+    {
+        TickerSet ticks;
+        for (size_t c = _next++; c < _sums.size(); c = _next++)
+        {
+            size_t end = (c + 1) * s_chunk;
+            if (end > _symbols.size()) end = _symbols.size();
+
+            for (size_t i = c * s_chunk; i < end; ++i)
+            {
+                TickerSet& t = _resident ? _ticks[i] : ticks;
+                t.clear();
+                if (!parse(*_symbols[i], t)) continue;
+
+                _parsed[i] = true;
+                _sums[c].add_ticks(t);
+                if (!_resident) save(*_symbols[i], t);
+            }
+        }
+    }
+
+    //  write_work
+    //      Thread Main for write_resident. Take the next symbol,
+    //      apply the background and write it, until there are none
+    //      left.
+    //
+    void write_work()
+    {
+        for (size_t i = _next++; i < _symbols.size(); i = _next++)
+        {
+            if (!_parsed[i]) continue;
+
+            const SymbolDescriptor& sd    = *_symbols[i];
+            TickerSet&              ticks = _ticks[i];
+
+            Backgrounder::apply(ticks);
+            save(sd, ticks);
+            Backgrounder::add_to_store(sd, ticks);
+            TickerSet().swap(ticks);
+        }
+    }
+
+    //  threads_for
+    //      Threads to use on some units of work.
+    //
+    inline int threads_for(size_t units) const
+    {
+        int threads = _threads;
+        if (threads > int(units)) threads = units;
+        if (1 > threads) threads = 1;
+        return threads;
+    }
+
+    inline static double seconds_since(const boost::posix_time::ptime& start)
+    {
+        return (boost::posix_time::microsec_clock::universal_time() -
+                start).total_microseconds() / 1.0e6;
+    }
+
+    //  s_chunk
+    //      Symbols summed together.
+    //
+    static const size_t s_chunk = 32;
+
+    //  _fetcher
+    //  _threads
+    //  _resident
+    //      Where the files come from, how many at once, and whether
+    //      to keep the ticks.
+    //
+    Fetcher& _fetcher;
+    int      _threads;
+    bool     _resident;
+
+    //  _symbols
+    //  _sums
+    //  _next
+    //      The list, the background of each chunk of it, and the
+    //      next unit of work to take.
+    //
+    vector<const SymbolDescriptor *> _symbols;
+    vector<BackgroundSums>           _sums;
+    boost::atomic<size_t>            _next;
+
+    //  _ticks
+    //  _parsed
+    //      Each symbol's ticks, when resident, and whether it had
+    //      a file (a char each, so threads don't share bits).
+    //
+    vector<TickerSet> _ticks;
+    vector<char>      _parsed;
+
+    //  _ingested
+    //  _bytes
+    //      Symbols with a file and CSV bytes read.
+    //
+    boost::atomic<int>      _ingested;
+    boost::atomic<uint64_t> _bytes;
+
+private:
+    //  Do Not Copy
+    //
+    Ingester(const Ingester&);
+    Ingester& operator=(const Ingester&);
+};
+
+
+string clean_up_symbol(string_view symbol)
+{
+    string stemp(symbol);
+    boost::replace_first(stemp, "$", "-P");
+    boost::replace_first(stemp, ".", "-");
+    return stemp;
+}
+
+// unquoted
+//      Copy a field without its quotes.
+//
+string unquoted(string_view field)
+{
+    string stemp;
+    stemp.reserve(field.size());
+    for (char c : field)
+        if ('"' != c) stemp += c;
+    return stemp;
 }
 
 // finviz
 //      Parse a finviz file line.
 //
-inline void finviz(const stringvector& elements, SymbolDescriptorSet& sd)
+inline void finviz(const fieldvector& elements, SymbolDescriptorSet& sd)
 {
     if( elements.size() < 6) return;
 
@@ -284,17 +721,17 @@ inline void finviz(const stringvector& elements, SymbolDescriptorSet& sd)
     // and push it onto the back of a list.
     
     sd.push_back(SymbolDescriptor(
-        clean_up_symbol(boost::erase_all_copy(elements[1], "\"")),   // Symbol
-        boost::erase_all_copy(elements[2], "\""),   // Company
-        boost::erase_all_copy(elements[3], "\""),   // Sector
-        boost::erase_all_copy(elements[4], "\""),   // Industry
-        boost::erase_all_copy(elements[5], "\""))); // Country
+        clean_up_symbol(unquoted(elements[1])),     // Symbol
+        unquoted(elements[2]),      // Company
+        unquoted(elements[3]),      // Sector
+        unquoted(elements[4]),      // Industry
+        unquoted(elements[5])));    // Country
 }
 
 // nasdaqlisted
 //      Parse a nasdaqlisted file.
 //
-inline void nasdaqlisted(const stringvector& elements, SymbolDescriptorSet& sd)
+inline void nasdaqlisted(const fieldvector& elements, SymbolDescriptorSet& sd)
 {
     if( elements.size() < 4) return;
 
@@ -308,13 +745,14 @@ inline void nasdaqlisted(const stringvector& elements, SymbolDescriptorSet& sd)
     // Kinda missing the sector and industry stuff... oh well.
     
     if( (6   >  elements[0].length()) &&  // last line is a date/time tag.
+        (!elements[3].empty()       ) &&
         ('N' == elements[3][0]      ) )   // not a test issue.
     {
         // construct a SymbolDescriptor
         // and push it onto the back of a list.
         sd.push_back(SymbolDescriptor(
             clean_up_symbol(elements[0]),   // Symbol
-            elements[1],   // Company
+            string(elements[1]),   // Company
             " ",           // Sector
             " ",           // Industry
             " "));         // Country
@@ -325,7 +763,7 @@ inline void nasdaqlisted(const stringvector& elements, SymbolDescriptorSet& sd)
 // otherlisted
 //      Parse an Other-Listed TXT file into a set of Symbol descriptors.
 //
-inline void otherlisted(const stringvector& elements, SymbolDescriptorSet& sd)
+inline void otherlisted(const fieldvector& elements, SymbolDescriptorSet& sd)
 {
     if( elements.size() < 7) return;
 
@@ -341,13 +779,14 @@ inline void otherlisted(const stringvector& elements, SymbolDescriptorSet& sd)
     // Kinda missing the sector and industry stuff... oh well.
     
     if( (6   >  elements[0].length()) &&  // last line is a date/time tag.
+        (!elements[6].empty()       ) &&
         ('N' == elements[6][0]      ) )   // not a test issue.
     {
         // construct a SymbolDescriptor
         // and push it onto the back of a list.
         sd.push_back(SymbolDescriptor(
             clean_up_symbol(elements[0]),   // Symbol
-            elements[1],   // Company
+            string(elements[1]),   // Company
             " ",           // Sector
             " ",           // Industry
             " "));         // Country
@@ -373,7 +812,7 @@ public:
     //      
     bool operator()(const SymbolDescriptor& sd)
     {
-        if(!boost::filesystem::exists(sd.DATFile))
+        if(!constants::data_dir.exists(sd.DATFile))
         {
             s_count++;
             return true;
@@ -388,37 +827,130 @@ private:
 int MissingOrEmpty::s_count(0);
 
 
+// ingest_all
+//      Ingest every symbol, then record the background and apply it.
+//      fetcher   - where the CSV files come from.
+//      symbols   - the list.
+//      threads   - symbols to work on at once.
+//      in_memory - keep the ticks in memory and write each symbol
+//                  once, instead of writing and rewriting them.
+//
+template<class Fetcher>
+void ingest_all(Fetcher&                   fetcher,
+                const SymbolDescriptorSet& symbols,
+                int                        threads,
+                bool                       in_memory)
+{
+    Ingester<Fetcher> ingester(fetcher, threads);
+    if (in_memory) ingester.keep_resident();
+
+    // debugging - get data for the first Symbol (A)
+    // ingester.ingest(symbols.front());
+
+    // normal - get data for all of the tickers.
+    ingester.run(symbols);
+
+    // compute and write out the background signals.
+    ::puts("Recording background signal...");
+    Backgrounder::record_backgrounds();
+
+    // apply the background signal.
+    ::puts("Applying background signal...");
+    if (in_memory)
+        ingester.write_resident();
+    else
+        Backgrounder::apply_all(symbols, threads);
+}
+
+
 // main
 //      Use this program to download a pile of historical
 //      stock data.
 //
 int main(int argc, char * argv[])
 {
-    // Change directories into the lists directory.
+    // Command line processing.
+    //
+    string mirror_path;
+    int    threads;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "getdata - Download the lists and historical data.")
+        ("mirror", po::value< string >(&mirror_path),
+         "Work offline: read <Symbol>.csv files from this directory "
+         "instead of downloading them, and use the lists already in "
+         "the lists directory.")
+        ("threads", po::value< int >(&threads),
+         "Symbols to work on at once (default 1, or the number of "
+         "cores with --mirror).")
+        ("in-memory",
+         "Keep the ticks in memory until the background is applied, "
+         "and write each symbol once instead of writing the ticker "
+         "files and rewriting them.")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+
+    bool offline   = (0 != vm.count("mirror"));
+    bool in_memory = (0 != vm.count("in-memory"));
+    if (!vm.count("threads"))
+    {
+        threads = 1;
+        if (offline) threads = boost::thread::hardware_concurrency();
+    }
+    if (1 > threads)
+    {
+        cout << "Bad --threads: " << threads << endl;
+        return 1;
+    }
+
+    // The lists go in the lists directory.
     ::puts(constants::lists_path.base_path());
-    WorkingDirectory current_dir(constants::lists_path.base_path());
+    const Directory& lists_dir = constants::lists_dir;
 
     // Get and concatenate the lists.
-    ::puts("Snarfing up lists....");
-    Snarf::up_some_lists();
+    if (!offline)
+    {
+        ::puts("Snarfing up lists....");
+        Snarf::up_some_lists();
+    }
     SymbolDescriptorSet the_tickers;
     cout << "Parsing finviz.csv..." << endl;
-    FileParser("finviz.csv",       ",").load_using(finviz,       the_tickers);
+    MappedFileParser(lists_dir, "finviz.csv",       ",").load_using(finviz,       the_tickers);
     cout << "Parsing nasdaqlisted.txt..." << endl;
-    FileParser("nasdaqlisted.txt", "|").load_using(nasdaqlisted, the_tickers);
+    MappedFileParser(lists_dir, "nasdaqlisted.txt", "|").load_using(nasdaqlisted, the_tickers);
     cout << "Parsing otherlisted.txt..." << endl;
-    FileParser("otherlisted.txt",  "|").load_using(otherlisted,  the_tickers);
+    MappedFileParser(lists_dir, "otherlisted.txt",  "|").load_using(otherlisted,  the_tickers);
 
     // Trim out all of the duplicates & sort by ticker symbol.
+    remove_duplicate_symbols(the_tickers);
     the_tickers.sort();
-    the_tickers.unique();
     
-    // Change directories into the data directory.
-    // makes call to wget-YF-table shell script a bunch simpler.
+    // The ticks go in the data directory.
     ::puts(constants::data_path.base_path());
-    current_dir.chdir(constants::data_path.base_path());
 
     // snarf the data building a background signal
+    if (offline)
+    {
+        Mirror mirror(mirror_path.c_str());
+        if (!mirror.is_open())
+        {
+            cout << "Bad --mirror: " << mirror_path << endl;
+            return 1;
+        }
+
+        ingest_all(mirror, the_tickers, threads, in_memory);
+    }
+    else
     {
         // construct a string representing the start and end dates
         // Note that months are 0 indexed...
@@ -427,22 +959,7 @@ int main(int argc, char * argv[])
         Snarf::set_start_and_end(constants::start_date, constants::end_date);
 
         Snarf ocelot;
-        // debugging - get data for the first Symbol (A)
-        // ocelot(the_tickers.front());
-        
-        // normal - get data for all of the tickers.
-        the_tickers.foreach(ocelot);
-    }
-    
-    {
-        // compute and write out the background signals.
-        ::puts("Recording background signal...");
-        Backgrounder::record_backgrounds();
-
-        // apply the background signal.
-        ::puts("Applying background signal...");
-        Backgrounder apply_background;
-        the_tickers.foreach(apply_background);
+        ingest_all(ocelot, the_tickers, threads, in_memory);
     }
     
     // remove all of the ticker symbols that didn't download from the list.
@@ -452,13 +969,17 @@ int main(int argc, char * argv[])
         the_tickers.remove_if(m_or_e);
         ::printf("Removed %i tickers from the list.\n", MissingOrEmpty::count());
     }
+
+    // and write all of the closes into the tick store.
+    ::puts("Writing tick store...");
+    if (!Backgrounder::record_store(the_tickers))
+        ::puts("Failed to write the tick store!");
     
     // and write out to SymbolDescriptors.txt
     ::puts(constants::lists_path.base_path());
-    current_dir.chdir(constants::lists_path.base_path());
     
     ::puts("Final list written to SymbolDescriptors.txt");
-    save_to(the_tickers, constants::lists_path("SymbolDescriptors.txt"));
+    save_to(the_tickers, lists_dir, "SymbolDescriptors.txt");
     
     return 0;
 }
@@ -1,6 +1,5 @@
 #include <iostream>
 #include <vector>
-#include <boost/filesystem.hpp>
 #include <boost/graph/adjacency_matrix.hpp>
 #include <boost/graph/connected_components.hpp>
 #include "../include/correlations.h"
@@ -22,10 +21,9 @@ void make_clusters_for_date(const DateIndex::IndexType idate, MeetsCriteria& mc)
     using namespace boost;
 
     string filename = lexical_cast<string>(idate);
-    WorkingDirectory current_dir(constants::lists_path.base_path());
 
     // Make sure there's something to do...
-    if(!boost::filesystem::exists(filename))
+    if(!constants::lists_dir.exists(filename))
     {
         cout << "Skipping day " << filename << " - no data." << endl;
         return;
@@ -36,14 +34,12 @@ void make_clusters_for_date(const DateIndex::IndexType idate, MeetsCriteria& mc)
 
     //  Load up a list of symbols. These are the vertices.
     SymbolVector vertex;
-    load_symbols_from(vertex, filename.c_str());
+    load_symbols_from(vertex, constants::lists_dir, filename);
     
     //  Load up the full set of correlations. This is all of the edges.
-    current_dir.chdir(constants::correlations_path.base_path());
-
     cout << "   Loading cross correlations matrix ..." << endl;
     FloatCrossCorrelation unfiltered_edges;
-    unfiltered_edges.load_from(filename.c_str());
+    unfiltered_edges.load_from(constants::correlations_dir, filename);
 
     //  Construct graph from loaded set of vertices and some of the edges.
     typedef adjacency_matrix< undirectedS > Graph;
@@ -74,27 +70,28 @@ void make_clusters_for_date(const DateIndex::IndexType idate, MeetsCriteria& mc)
 
     cout << "   Writing out clustering ..." << endl;
 
-    deque< list< string > > cluster;
+    //  Clusters hold vertex numbers, which are the symbols' rows,
+    //  and are named on the way out.
+    deque< list< int > > cluster;
     cluster.resize(num);
     
     for (vector<int>::size_type i = 0; i < component.size(); ++i)
     {
-        cluster[component[i]].push_back(vertex[i]);
+        cluster[component[i]].push_back(int(i));
     }
 
     //  Write components out to file as lines of text.
-    current_dir.chdir(constants::lists_path.base_path());
     filename += ".clustering";
     {
-        ofstream cfile(filename.c_str());
+        OutFile cfile(constants::lists_dir, filename);
         
-        BOOST_FOREACH( list< string > clust, cluster )
+        BOOST_FOREACH( const list< int >& clust, cluster )
         {
             if ( 1 < clust.size() )
             {
-                BOOST_FOREACH( string clu, clust )
+                BOOST_FOREACH( int clu, clust )
                 {
-                    cfile << clu << " ";
+                    cfile << vertex[clu] << " ";
                 }
                 cfile << endl << endl;
             }
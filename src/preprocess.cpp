@@ -1,16 +1,29 @@
 #include <stdio.h>
 #include <stdarg.h>
 #include <fstream>
+#include <map>
 #include "../include/tickers.h"
 #include "../include/symbols.h"
 #include "../include/constants.h"
 #include "../include/signals.h"
+#include "../include/tick_store.h"
+#include "../include/day_rows.h"
+#include "../include/trading_calendar.h"
+#include "../include/masked_signal.h"
+#include "../include/window_validity.h"
 #include "../include/accumulator.h"
+#include "../include/batched_accumulator.h"
+#include "../include/window_bank.h"
+#include "../include/ewma.h"
 #include "../include/progress_bar.h"
 #include <boost/lexical_cast.hpp>
-#include <boost/filesystem.hpp>
 #include <boost/thread.hpp>
+#include <boost/bind/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/program_options.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 
+namespace po = boost::program_options;
 using namespace std;
 
 //  AccumulationEngine
@@ -20,23 +33,46 @@ using namespace std;
 //               If the list is greater than one in length,
 //                  Write out list and current set of 
 //                  Statistical data from each accumulator.
+//      Each engine owns all of its state.
 //
 class AccumulationEngine
 {
 public:
+    //  Constructor
+    //      Nothing loaded, every option off, the whole date range.
+    //
+    AccumulationEngine() :
+        _global_ids(0),
+        _use_store(true),
+        _load_threads(4),
+        _next_load(0),
+        _bytes_loaded(0),
+        _first_date(DateIndex::first()),
+        _last_date(DateIndex::last()),
+        _first_day(0),
+        _last_day(0),
+        _use_bank(false),
+        _use_ewma(false),
+        _use_simd(false),
+        _check_simd(false),
+        _simd_mismatches(0),
+        _days_flushed(0),
+        _next_unit(0) { }
+
     //  load_data
     //      Load up all of the support data for precomputing the
     //      statistical data for a cross-correlation.
     //      Loads the main list of symbol descriptors.
-    //      Loads all of the ticker files into signals.
+    //      Loads all of the ticks into signals, from the tick store
+    //      if there is one, otherwise from the ticker files, and keeps
+    //      just the days something traded (see TradingCalendar).
+    //      Prints the load time and rate.
     //      Chews up about 100Mb of RAM.
     //
-    static bool load_data()
+    bool load_data()
     {
-        WorkingDirectory current_dir(constants::lists_path.base_path());
-
         ::puts("Loading symbol descriptors...");
-        load_from(_symbol, "SymbolDescriptors.txt");
+        load_from(_symbol, constants::lists_dir, "SymbolDescriptors.txt");
         
         // Probably didn't run getdata first...
         //
@@ -45,23 +81,18 @@ public:
             ::puts("Error loading symbol descriptors! Run getdata first.");
             return false;
         }
+        assign_global_ids();
         
-        current_dir.chdir(constants::data_path.base_path());
-        
-        _progress_bar.reset("Loading _all_ of the ticks...", _symbol.size());
+        if (!load_store()) load_tick_files();
 
-        BOOST_FOREACH(SymbolDescriptor sd, _symbol)
-        {
-            TickerSignal temp;
-            temp.load_from(sd.DATFile.c_str());
-            _ticker.push_back(temp);
+        ::printf("\n%i trading days in %i calendar days.\n",
+                 _calendar.size(), DateIndex::interval());
 
-            _progress_bar.increment();
-        }
+        ::puts("\nLoading the background.");
+        _bkg.load_from(constants::data_dir, "background.dat");
+        _bkg.compact(_calendar);
 
-        ::puts("\nLoading backgrounds.");
-        _bdc.load_from("bkg_delta_close.dat");
-        _bdac.load_from("bkg_delta_adjclose.dat");
+        compute_changes();
 
         // Allocate room for the means and the moving averages.
         //
@@ -75,142 +106,1032 @@ public:
         _adcb.resize(_ticker.size());
         _adacb.resize(_ticker.size());
 
+        if (_use_simd)
+        {
+            int batches = (_ticker.size() + FloatLanes::width - 1) /
+                          FloatLanes::width;
+            _sdc.resize(batches);
+            _sdac.resize(batches);
+            _sdcb.resize(batches);
+            _sdacb.resize(batches);
+        }
+
+        if (_use_bank)
+        {
+            _wmdc.resize(_ticker.size());
+            _wmdac.resize(_ticker.size());
+            _wmdcb.resize(_ticker.size());
+            _wmdacb.resize(_ticker.size());
+
+            _wadc.resize(_ticker.size());
+            _wadac.resize(_ticker.size());
+            _wadcb.resize(_ticker.size());
+            _wadacb.resize(_ticker.size());
+        }
+
+        if (_use_ewma)
+        {
+            _emdc.resize(_ticker.size());
+            _emdac.resize(_ticker.size());
+            _emdcb.resize(_ticker.size());
+            _emdacb.resize(_ticker.size());
+
+            _eadc.resize(_ticker.size());
+            _eadac.resize(_ticker.size());
+            _eadcb.resize(_ticker.size());
+            _eadacb.resize(_ticker.size());
+        }
+
+        if (_check_simd)
+        {
+            _cdc.resize(_ticker.size());
+            _cdac.resize(_ticker.size());
+            _cdcb.resize(_ticker.size());
+            _cdacb.resize(_ticker.size());
+        }
+
         // Every symbol should have a ticker.
         //
         return _ticker.size() == _symbol.size();
     }
 
+    //  load_store
+    //      Fill the ticker signals from the tick store written by
+    //      getdata: one mapped file instead of a file per symbol.
+    //      returns false (loading nothing) if there's no usable store,
+    //      it's missing a symbol, or the store is turned off.
+    //
+    bool load_store()
+    {
+        if (!_use_store) return false;
+
+        TickStore store;
+        if (!store.open(constants::data_dir, constants::tick_store)) return false;
+
+        vector<int> ids;
+        BOOST_FOREACH(const SymbolDescriptor& sd, _symbol)
+        {
+            int id = store.find(sd.Symbol);
+            if (0 > id)
+            {
+                ::printf("%s isn't in the tick store, loading the ticker files.\n",
+                         sd.Symbol.c_str());
+                return false;
+            }
+            ids.push_back(id);
+        }
+
+        ::puts("Loading _all_ of the ticks from the tick store...");
+        boost::posix_time::ptime start(
+            boost::posix_time::microsec_clock::universal_time());
+
+        _calendar.clear();
+        store.count_days(ids, _calendar);
+        _calendar.build();
+
+        _ticker.resize(_symbol.size());
+        for (size_t i = 0; i < ids.size(); ++i)
+            store.load(ids[i], _ticker[i], _calendar);
+
+        // A row of closes and a row of the bitmap per symbol.
+        report_load(start, uint64_t(ids.size()) *
+                           (uint64_t(store.days()) * sizeof(int64_t) +
+                            uint64_t(store.days() + 63) / 64 * sizeof(uint64_t)));
+        return true;
+    }
+
+    //  load_tick_files
+    //      Fill the ticker signals from the per-symbol ticker files,
+    //      _load_threads files at a time. The signals are sized up
+    //      front and each file is read straight into its own.
+    //
+    void load_tick_files()
+    {
+        _progress_bar.reset("Loading _all_ of the ticks...", _symbol.size());
+        boost::posix_time::ptime start(
+            boost::posix_time::microsec_clock::universal_time());
+
+        _ticker.clear();
+        _ticker.resize(_symbol.size());
+        _next_load = 0;
+        _bytes_loaded = 0;
+
+        int threads = _load_threads;
+        if (threads > int(_symbol.size())) threads = _symbol.size();
+        if (1 > threads) threads = 1;
+
+        boost::thread_group loaders;
+        for (int i = 0; i < threads; i++)
+            loaders.create_thread(
+                boost::bind(&AccumulationEngine::load_tick_file_worker, this));
+        loaders.join_all();
+
+        report_load(start, _bytes_loaded);
+
+        // Number the days anything traded, and keep just those.
+        _calendar.clear();
+        BOOST_FOREACH(const TickerSignal& ts, _ticker)
+        {
+            for (int date = 0; date < DateIndex::interval(); ++date)
+                if (Tick::is_valid(ts.sample[date])) _calendar.add(date);
+        }
+        _calendar.build();
+
+        BOOST_FOREACH(TickerSignal& ts, _ticker)
+            ts.compact(_calendar);
+    }
+
+    //  load_tick_file_worker
+    //      Thread Main for load_tick_files. Take the next symbol and
+    //      load its file until there are none left.
+    //
+    void load_tick_file_worker()
+    {
+        for (int i = _next_load++; i < int(_symbol.size()); i = _next_load++)
+        {
+            const string& filename = _symbol[i].DATFile;
+
+            off_t bytes = constants::data_dir.file_size(filename);
+            if (0 < bytes) _bytes_loaded += bytes;
+
+            _ticker[i].load_from(constants::data_dir, filename);
+            _progress_bar.increment();
+        }
+    }
+
+    //  report_load
+    //      Print how long loading the ticks took and how fast it went.
+    //      start - when loading started.
+    //      bytes - bytes read.
+    //
+    void report_load(const boost::posix_time::ptime& start,
+                     uint64_t                        bytes)
+    {
+        double seconds = (boost::posix_time::microsec_clock::universal_time() -
+                          start).total_microseconds() / 1.0e6;
+        double mb = bytes / (1024.0 * 1024.0);
+
+        ::printf("\nLoaded %i symbols, %.1f MB in %.3f s (%.1f MB/s).\n",
+                 int(_ticker.size()), mb, seconds,
+                 (0.0 < seconds) ? (mb / seconds) : 0.0);
+    }
+
+    //  use_tick_files
+    //      Load the ticker files even if there's a tick store.
+    //      Call before load_data.
+    //
+    inline void use_tick_files() { _use_store = false; }
+
+    //  use_load_threads
+    //      Number of ticker files to read at once. Call before load_data.
+    //
+    inline void use_load_threads(int threads) { _load_threads = threads; }
+
+    //  use_simd
+    //      Update FloatLanes::width symbols at a time with the batched
+    //      accumulators. Call before load_data.
+    //      check - also run the scalar accumulators and count any
+    //              differences in the results.
+    //
+    inline void use_simd(bool check)
+    {
+        _use_simd = true;
+        _check_simd = check;
+    }
+
+    //  use_window_bank
+    //      Also compute every window in FloatWindowBank and write
+    //      them to the bank.* files. Call before load_data.
+    //
+    inline void use_window_bank() { _use_bank = true; }
+
+    //  use_ewma
+    //      Also compute exponentially weighted moving averages for
+    //      the half-lives in EwmaHalfLives and write them to the
+    //      ewma.* files. Call before load_data.
+    //
+    inline void use_ewma() { _use_ewma = true; }
+
+    //  stop_before
+    //      Process the dates before this one rather than up to the
+    //      end date, and leave the checkpoint there for a later
+    //      --append to carry on from.
+    //      returns false if the date isn't in the date range.
+    //
+    inline bool stop_before(int date)
+    {
+        if ((DateIndex::first() >= date) || (DateIndex::last() < date))
+            return false;
+
+        _last_date = date;
+        return true;
+    }
+
+    //  simd_mismatches
+    //      Number of symbol-days where the batched and scalar
+    //      accumulators disagreed (only counted when checking).
+    //
+    inline int simd_mismatches() { return _simd_mismatches; }
+
     //  initialize_engine
-    //      Reset the progress bar and use it as a counter.
+    //      Reset the progress bar and use it as a counter
+    //      from the first unprocessed trading day.
     //
-    inline static void initialize_engine() 
+    inline void initialize_engine() 
     {
-        _progress_bar.reset("Pre-processing data...", DateIndex::last());
+        _first_day = _calendar.first_from(_first_date);
+        _last_day  = _calendar.first_from(_last_date);
+        _progress_bar.reset("Pre-processing data...",
+                            _last_day - _first_day);
     }
     
     //  done
-    //      Return true if the counter has reached the last date.
+    //      Return true if the counter has reached the last trading day.
     //
-    inline static bool done()
+    inline bool done()
     {
-        return (_progress_bar.count() >= DateIndex::last());
+        return (_first_day + _progress_bar.count() >= _last_day);
     }
     
     //  process_a_date
-    //      Compute the statistical data for a day and store it.
+    //      Compute the statistical data for a trading day and store it.
     //
-    static void process_a_date()
+    void process_a_date()
     {
-        int date = _progress_bar.count();
+        int day = _first_day + _progress_bar.count();
         
         // make sure there's something to compute...
-        int got_data_count = 0;
-        for (int i = 0; i < _symbol.size(); ++i)
+        if (has_data(day))
         {
-            if (FloatType::is_valid(_ticker[i].sample[date].Close))
-                ++got_data_count;
+            int date = _calendar.date(day);
+            push_date(date);
+
+            _next_unit = 0;
+
+            // Construct some threads!
+            boost::thread_group workers;
+
+            for (unsigned int i = 0; i < boost::thread::hardware_concurrency(); i++)
+                workers.create_thread(AccumulationCylinder(*this, day));
 
-            if (1 < got_data_count) // need at least two to correlate.
-                break;
+            workers.join_all();
+
+            write_out_data(date);
         }
 
-        if (1 < got_data_count)
+        _progress_bar.increment();
+    }
+
+    //  process_by_symbol_range
+    //      Symbol-major alternative to looping on process_a_date.
+    //      Each worker owns a contiguous range of symbols and streams
+    //      it through every date, copying its results into a small
+    //      ring of per-day output buffers. A day is written out as soon
+    //      as every range has passed it. One thread group for the whole
+    //      run and no per-symbol lock.
+    //
+    void process_by_symbol_range()
+    {
+        // Find the days worth computing up front.
+        _days.clear();
+        int last_day = _calendar.first_from(_last_date);
+        for (int day = _calendar.first_from(_first_date); day < last_day; ++day)
         {
-            _dates.push_back(date);
-            
-            //  Limit the queue size to 50 days.
-            //
-            if (50 < _dates.size())
+            if (has_data(day)) _days.push_back(day);
+        }
+
+        _progress_bar.reset("Pre-processing data by symbol range...",
+                            _days.size());
+
+        for (int k = 0; k < s_day_buffer_depth; ++k)
+        {
+            _day_buffer[k].mdc.resize(_symbol.size());
+            _day_buffer[k].mdac.resize(_symbol.size());
+            _day_buffer[k].mdcb.resize(_symbol.size());
+            _day_buffer[k].mdacb.resize(_symbol.size());
+            if (_use_bank)
+            {
+                _day_buffer[k].wmdc.resize(_symbol.size());
+                _day_buffer[k].wmdac.resize(_symbol.size());
+                _day_buffer[k].wmdcb.resize(_symbol.size());
+                _day_buffer[k].wmdacb.resize(_symbol.size());
+            }
+            if (_use_ewma)
             {
-                _dates.pop_front();
+                _day_buffer[k].emdc.resize(_symbol.size());
+                _day_buffer[k].emdac.resize(_symbol.size());
+                _day_buffer[k].emdcb.resize(_symbol.size());
+                _day_buffer[k].emdacb.resize(_symbol.size());
             }
+            _day_buffer[k].ranges_done = 0;
+        }
+        _days_flushed = 0;
 
-            reset_semaphore();
+        // Split the symbols (or batches of them) into one range per core.
+        int range_count = boost::thread::hardware_concurrency();
+        if (range_count > unit_count()) range_count = unit_count();
+        if (1 > range_count) range_count = 1;
 
-            // Construct some threads!
-            boost::thread_group workers;
+        boost::thread_group workers;
+        for (int i = 0; i < range_count; i++)
+        {
+            workers.create_thread(SymbolRangeCylinder(*this,
+                (i * unit_count()) / range_count,
+                ((i + 1) * unit_count()) / range_count));
+        }
 
-            for (int i = 0; i < boost::thread::hardware_concurrency(); i++)
-                workers.create_thread(AccumulationCylinder(date));
+        // Flush the days in order as the ranges finish them.
+        for (int k = 0; k < int(_days.size()); ++k)
+        {
+            DayBuffer& day = _day_buffer[k % s_day_buffer_depth];
+            {
+                boost::unique_lock<boost::mutex> lock(_day_mutex);
+                while (range_count > day.ranges_done)
+                    _day_condition.wait(lock);
+            }
 
-            workers.join_all();
+            int date = _calendar.date(_days[k]);
+            push_date(date);
+            write_out_data(date, day.mdc, day.mdac, day.mdcb, day.mdacb);
+            if (_use_bank)
+            {
+                write_out_bank(date, day.mdc,
+                               day.wmdc, day.wmdac, day.wmdcb, day.wmdacb);
+            }
+            if (_use_ewma)
+            {
+                write_out_ewma(date,
+                               day.emdc, day.emdac, day.emdcb, day.emdacb);
+            }
 
-            write_out_data(date);
+            {
+                boost::lock_guard<boost::mutex> lock(_day_mutex);
+                day.ranges_done = 0;
+                ++_days_flushed;
+            }
+            _day_condition.notify_all();
+
+            _progress_bar.increment();
         }
 
-        _progress_bar.increment();
+        workers.join_all();
     }
     
+    //  save_checkpoint
+    //      Persist the accumulators and the recent dates after the last
+    //      processed day so that a later run can append new days
+    //      without replaying the whole history.
+    //
+    bool save_checkpoint()
+    {
+        // The batched accumulators keep the state in SIMD mode.
+        if (_use_simd)
+        {
+            for (size_t i = 0; i < _symbol.size(); ++i)
+            {
+                int batch = i / FloatLanes::width;
+                int lane  = i % FloatLanes::width;
+                _sdc[batch].store_lane(lane, _adc[i]);
+                _sdac[batch].store_lane(lane, _adac[i]);
+                _sdcb[batch].store_lane(lane, _adcb[i]);
+                _sdacb[batch].store_lane(lane, _adacb[i]);
+            }
+        }
+
+        OutFile of(constants::means_dir, constants::checkpoint, ios_base::binary);
+        if (!of.is_open()) return false;
+
+        bool binary = constants::save_as_binary;
+        constants::save_as_binary = true;
+
+        checkpoint_header().save(of);
+
+        // Dates are relative to the start date, so record it.
+        of << LongType(constants::start_date.julian_day())
+           << IntType(_last_date)
+           << IntType(_symbol.size());
+
+        BOOST_FOREACH(const SymbolDescriptor& sd, _symbol)
+        {
+            IntType length(sd.Symbol.length());
+            of << length;
+            of.write(sd.Symbol.data(), sd.Symbol.length());
+        }
+
+        of << IntType(_dates.size());
+        BOOST_FOREACH(int date, _dates)
+            of << IntType(date);
+
+        for (size_t i = 0; i < _symbol.size(); ++i)
+            of << _adc[i] << _adac[i] << _adcb[i] << _adacb[i];
+
+        of << IntType(_use_bank ? 1 : 0);
+        if (_use_bank)
+        {
+            save_window_header<FloatWindowBank::Lengths>(of);
+            for (size_t i = 0; i < _symbol.size(); ++i)
+                of << _wadc[i] << _wadac[i] << _wadcb[i] << _wadacb[i];
+        }
+
+        of << IntType(_use_ewma ? 1 : 0);
+        if (_use_ewma)
+        {
+            EwmaHalfLives::save_header(of);
+            for (size_t i = 0; i < _symbol.size(); ++i)
+                of << _eadc[i] << _eadac[i] << _eadcb[i] << _eadacb[i];
+        }
+
+        constants::save_as_binary = binary;
+        return of.good();
+    }
+
+    //  load_checkpoint
+    //      Restore the state saved by save_checkpoint and start
+    //      processing after the last day it covered.
+    //      Call after load_data. Fails if the checkpoint is missing
+    //      or was built from a different start date. The symbol lists
+    //      needn't match: state is matched up by symbol, new symbols
+    //      start fresh and the state of symbols that are gone is
+    //      dropped.
+    //
+    bool load_checkpoint()
+    {
+        InFile in(constants::means_dir, constants::checkpoint, ios_base::binary);
+        if (!in.is_open())
+        {
+            ::puts("No checkpoint found! Run without --append first.");
+            return false;
+        }
+
+        bool binary = constants::save_as_binary;
+        constants::save_as_binary = true;
+
+        bool ok = restore_checkpoint(in);
+
+        constants::save_as_binary = binary;
+
+        if (!ok)
+        {
+            ::puts("Checkpoint doesn't match the data! Run without --append.");
+            return false;
+        }
+
+        if (_use_simd)
+        {
+            for (size_t i = 0; i < _symbol.size(); ++i)
+            {
+                int batch = i / FloatLanes::width;
+                int lane  = i % FloatLanes::width;
+                _sdc[batch].load_lane(lane, _adc[i]);
+                _sdac[batch].load_lane(lane, _adac[i]);
+                _sdcb[batch].load_lane(lane, _adcb[i]);
+                _sdacb[batch].load_lane(lane, _adacb[i]);
+            }
+        }
+
+        ::printf("Appending from day %i.\n", _first_date);
+        return true;
+    }
+
 protected:
-    //  reset_semaphore
-    //      Set up the semaphore to loop through the symbols.
+    //  restore_checkpoint
+    //      Read the body of a checkpoint file, validating it
+    //      against the loaded symbols.
+    //
+    bool restore_checkpoint(istream& in)
+    {
+        // Checkpoints from before the header, or from a build that
+        // writes a different one, start over.
+        FileHeader header;
+        FileHeader expected(checkpoint_header());
+        if (!header.load(in)                                    ||
+            (FileHeader::current_version < header.version)      ||
+            (expected.layout != header.layout)                  ||
+            (expected.real_width != header.real_width)          ||
+            (FileHeader::endian_marker != header.endian)        )
+            return false;
+
+        LongType zero_date;
+        IntType  last_date;
+        IntType  symbol_count;
+        in >> zero_date >> last_date >> symbol_count;
+
+        if (!in.good()                                          ||
+            (zero_date != constants::start_date.julian_day())   ||
+            (0 > symbol_count)                                  ||
+            (header.symbol_count != uint32_t(symbol_count))     ||
+            (header.date != last_date)                          ||
+            (last_date > _last_date)                            )
+            return false;
+
+        // Find the loaded row of each checkpointed symbol.
+        //
+        SymbolTable loaded;
+        vector<int> loaded_row;
+        for (size_t i = 0; i < _symbol.size(); ++i)
+        {
+            SymbolId id = loaded.intern(_symbol[i].Symbol);
+            if (loaded_row.size() <= id) loaded_row.push_back(int(i));
+            else                         loaded_row[id] = int(i);
+        }
+
+        vector<int> row;
+        // Symbols are a few characters, a longer one is a damaged
+        // file rather than something to allocate.
+        const int max_symbol_length = 64;
+
+        for (int j = 0; j < symbol_count; ++j)
+        {
+            IntType length;
+            in >> length;
+            if (!in.good() || (0 > length) || (max_symbol_length < length))
+                return false;
+
+            string symbol(length, ' ');
+            in.read(&symbol[0], length);
+            if (!in.good()) return false;
+
+            SymbolId found = loaded.find(symbol);
+            row.push_back((no_symbol == found) ? -1 : loaded_row[found]);
+        }
+
+        int kept = int(row.size()) - int(count(row.begin(), row.end(), -1));
+        if (kept != int(_symbol.size()) || (row.size() != _symbol.size()))
+        {
+            ::printf("Carrying on %i symbols, starting %i new ones and "
+                     "dropping %i.\n", kept, int(_symbol.size()) - kept,
+                     int(row.size()) - kept);
+        }
+
+        IntType date_count;
+        in >> date_count;
+
+        _dates.clear();
+        for (int i = 0; (i < date_count) && in.good(); ++i)
+        {
+            IntType date;
+            in >> date;
+            _dates.push_back(date);
+        }
+
+        restore_rows(in, row, _adc, _adac, _adcb, _adacb);
+
+        // The window bank has to be carried on if it was started.
+        IntType has_bank;
+        in >> has_bank;
+        if (in.fail() || (_use_bank != (1 == has_bank))) return false;
+
+        if (_use_bank)
+        {
+            if (!load_window_header<FloatWindowBank::Lengths>(in))
+                return false;
+
+            restore_rows(in, row, _wadc, _wadac, _wadcb, _wadacb);
+        }
+
+        // So do the EWMAs, with the same half-lives.
+        IntType has_ewma;
+        in >> has_ewma;
+        if (in.fail() || (_use_ewma != (1 == has_ewma))) return false;
+
+        if (_use_ewma)
+        {
+            if (!EwmaHalfLives::load_header(in)) return false;
+
+            restore_rows(in, row, _eadc, _eadac, _eadcb, _eadacb);
+        }
+
+        if (in.fail()) return false;
+
+        _first_date = last_date;
+        return true;
+    }
+
+    //  checkpoint_header
+    //      FileHeader of the checkpoint: the symbols it holds and the
+    //      date it runs up to. The body isn't a run of records, so
+    //      there's no record size or count. Give a new body its own
+    //      layout.
+    //
+    FileHeader checkpoint_header()
+    {
+        FileHeader h = FileHeader::describe<FloatType>(
+            0, _symbol.size(), _last_date);
+        h.layout      = layout_checkpoint;
+        h.record_size = 0;
+        return h;
+    }
+
+    //  restore_rows
+    //      Read one set of checkpointed state, four per symbol, into
+    //      the loaded symbols' rows.
+    //      row - loaded row of each checkpointed symbol, -1 for one
+    //            that's gone, whose state is read and dropped.
+    //
+    template<class Deque>
+    void restore_rows(istream& in, const vector<int>& row,
+                      Deque& a, Deque& b, Deque& c, Deque& d)
+    {
+        typename Deque::value_type dropped;
+        for (size_t j = 0; (j < row.size()) && in.good(); ++j)
+        {
+            int i = row[j];
+            if (0 <= i)
+                in >> a[i] >> b[i] >> c[i] >> d[i];
+            else
+                in >> dropped >> dropped >> dropped >> dropped;
+        }
+    }
+
+    //  has_data
+    //      Return true if at least two symbols traded on a trading day.
+    //
+    inline bool has_data(int day)
+    {
+        return (1 < _calendar.samples(day)); // need at least two to correlate.
+    }
+
+    //  compute_changes
+    //      Turn the closes into the day to day changes the moving
+    //      averages take. The ticker files hold the adjusted close with
+    //      getdata's background taken out (CloseNoBkg = close * bkg,
+    //      bkg the mean previous / current close of the date), so:
+    //          close     = CloseNoBkg / bkg
+    //          change    = close / previous close - 1
+    //          _bdc      = 1 / bkg - 1, the mean change of the date
+    //      A symbol's first close has no change, and neither does a
+    //      day without a usable background (_bdc is 0 there). All by
+    //      trading day. The changes are masked signals: a change that
+    //      isn't there is 0 with its bit clear, so the accumulators
+    //      take it as is. Call once the ticks and the background are
+    //      loaded.
+    //
+    void compute_changes()
+    {
+        _bdc.sample.assign(_calendar.size(), FloatType(0.0f));
+        for (int day = 0; day < _calendar.size(); ++day)
+        {
+            if (FloatType::is_valid(_bkg.sample[day]) && (0.0f != _bkg.sample[day]))
+                _bdc.sample[day] = 1.0f / _bkg.sample[day].value - 1.0f;
+        }
+
+        _change.resize(_ticker.size());
+        for (size_t i = 0; i < _ticker.size(); ++i)
+        {
+            const TickerSignal& ts = _ticker[i];
+            MaskedSignal& change = _change[i];
+            change.resize(_calendar.size());
+
+            float previous = FloatType::invalid_value;
+            for (int day = 0; day < _calendar.size(); ++day)
+            {
+                if (!Tick::is_valid(ts.sample[day])) continue;
+
+                float close = float(ts.sample[day].CloseNoBkg.value)
+                            / _bkg.sample[day].value;
+                if (FloatType::is_valid(previous) && (0.0f != previous))
+                    change.set(day, close / previous - 1.0f);
+                previous = close;
+            }
+        }
+    }
+
+    //  push_date
+    //      Track the dates covered by the longest moving average.
     //
-    static void reset_semaphore()
+    void push_date(int date)
     {
-        static DoNothing slack; // only need one of these...
-        EngineSemaphore::reset(slack);
+        _dates.push_back(date);
         
-        // start at -1, first thread incremenets... <hack />
-        EngineSemaphore::decrement(slack);
+        //  Limit the queue size to 50 days.
+        //
+        if (50 < _dates.size())
+        {
+            _dates.pop_front();
+        }
     }
 
-    //  write_out_data
-    //      Write out the data. Builds five files, one record at a time.
+    //  accumulate
+    //      Update the four accumulators of one symbol for one date.
+    //      isymbol - Symbol index.
+    //      iday    - Current trading day.
     //
-    static void write_out_data(int date)
+    void accumulate(int isymbol, int iday)
     {
-        // make sure there's something to write...
+        // Not all symbols trade every day, but only here
+        // if some symbols traded on this day. No trade, no change,
+        // and the same for a symbol's first close: a missing change
+        // is already 0.
+        bool traded = changed(isymbol, iday);
+
+        FloatType dc  = _change[isymbol].value[iday];
+        FloatType dcb = dc - _bdc.sample[iday];
+
+        // The ticker files only keep the adjusted close, so the close
+        // and adjusted close sets get the same changes.
+        _adc[isymbol].update(dc, _mdc[isymbol]);
+
+        _adac[isymbol].update(dc, _mdac[isymbol]);
+
+        _adcb[isymbol].update(dcb, _mdcb[isymbol]);
+
+        _adacb[isymbol].update(dcb, _mdacb[isymbol]);
+
+        if (_use_bank || _use_ewma)
+            accumulate_extras(isymbol, dc, dc, dcb, dcb, traded);
+    }
+
+    //  changed
+    //      The symbol has a real change on the trading day: it traded
+    //      then and has a close before it.
+    //
+    inline bool changed(int isymbol, int iday)
+    {
+        return _change[isymbol].is_valid(iday);
+    }
+
+    //  accumulate_extras
+    //      Update the window bank and/or the EWMAs of one symbol
+    //      with the four values already computed for the current date.
+    //      traded - the symbol has a real change (see changed); the
+    //               values aren't made up.
+    //
+    void accumulate_extras(int              isymbol,
+                           const FloatType& dc,
+                           const FloatType& dac,
+                           const FloatType& dcb,
+                           const FloatType& dacb,
+                           bool             traded)
+    {
+        if (_use_bank)
+        {
+            _wadc[isymbol].update(dc, _wmdc[isymbol]);
+            _wadac[isymbol].update(dac, _wmdac[isymbol]);
+            _wadcb[isymbol].update(dcb, _wmdcb[isymbol]);
+            _wadacb[isymbol].update(dacb, _wmdacb[isymbol]);
+        }
+
+        // The EWMAs carry over the days without a real change, so
+        // a pair's covariance only moves on days both symbols traded.
+        if (_use_ewma)
+        {
+            FloatType none;
+            _eadc[isymbol].update(traded ? dc : none, _emdc[isymbol]);
+            _eadac[isymbol].update(traded ? dac : none, _emdac[isymbol]);
+            _eadcb[isymbol].update(traded ? dcb : none, _emdcb[isymbol]);
+            _eadacb[isymbol].update(traded ? dacb : none, _emdacb[isymbol]);
+        }
+    }
+
+    //  unit_count
+    //      Number of units of work per date: symbols, or batches
+    //      of symbols when using the batched accumulators.
+    //
+    int unit_count()
+    {
+        return _use_simd ? _sdc.size() : _symbol.size();
+    }
+
+    //  unit_begin
+    //  unit_end
+    //      First symbol index of a unit of work, and one past its last.
+    //
+    int unit_begin(int unit)
+    {
+        return _use_simd ? (unit * FloatLanes::width) : unit;
+    }
+
+    int unit_end(int unit)
+    {
+        int end     = unit_begin(unit + 1);
+        int symbols = int(_symbol.size());
+        return (end < symbols) ? end : symbols;
+    }
+
+    //  accumulate_unit
+    //      Update one unit of work for one trading day.
+    //
+    void accumulate_unit(int unit, int iday)
+    {
+        if (_use_simd)
+            accumulate_batch(unit, iday);
+        else
+            accumulate(unit, iday);
+    }
+
+    //  accumulate_batch
+    //      Update the four batched accumulators of FloatLanes::width
+    //      symbols for one date. Same inputs as accumulate.
+    //      ibatch - Batch index.
+    //      iday   - Current trading day.
+    //
+    void accumulate_batch(int ibatch, int iday)
+    {
+        const int W = FloatLanes::width;
+
+        float dc[W]    __attribute__((aligned(64)));
+        float dac[W]   __attribute__((aligned(64)));
+        float dcb[W]   __attribute__((aligned(64)));
+        float dacb[W]  __attribute__((aligned(64)));
+        bool  traded[W];
+
+        FloatStatisticalData * mdc[W];
+        FloatStatisticalData * mdac[W];
+        FloatStatisticalData * mdcb[W];
+        FloatStatisticalData * mdacb[W];
+
+        for (int lane = 0; lane < W; ++lane)
+        {
+            size_t isymbol = size_t(ibatch) * W + lane;
+            if (_symbol.size() <= isymbol)
+            {
+                dc[lane] = dac[lane] = dcb[lane] = dacb[lane] =
+                    FloatType::invalid_value;
+                mdc[lane] = mdac[lane] = mdcb[lane] = mdacb[lane] = 0;
+                continue;
+            }
+
+            traded[lane] = changed(isymbol, iday);
+
+            FloatType change = _change[isymbol].value[iday];
+
+            dc[lane]   = dac[lane]  = change;
+            dcb[lane]  = dacb[lane] = change - _bdc.sample[iday];
+
+            mdc[lane]   = &_mdc[isymbol];
+            mdac[lane]  = &_mdac[isymbol];
+            mdcb[lane]  = &_mdcb[isymbol];
+            mdacb[lane] = &_mdacb[isymbol];
+        }
+
+        _sdc[ibatch].update(dc, mdc);
+        _sdac[ibatch].update(dac, mdac);
+        _sdcb[ibatch].update(dcb, mdcb);
+        _sdacb[ibatch].update(dacb, mdacb);
+
+        if (_use_bank || _use_ewma)
         {
-            int got_data_count = 0;
-            for (int i = 0; i < _symbol.size(); ++i)
+            for (int lane = 0; lane < W; ++lane)
             {
-                if (FloatType::is_valid(_mdc[i].value)         &&
-                    FloatType::is_valid(_mdc[i].fifty_day.mean))
-                    ++got_data_count;
+                size_t isymbol = size_t(ibatch) * W + lane;
+                if (_symbol.size() <= isymbol) break;
 
-                if (1 < got_data_count) // need at least two to correlate.
-                    break;
+                accumulate_extras(isymbol, dc[lane], dac[lane],
+                                  dcb[lane], dacb[lane], traded[lane]);
             }
-            if (1 >= got_data_count) return; // nothing to do.
         }
 
-        string sdate(boost::lexical_cast< string >(date));
-        ofstream of_symbols(constants::lists_path(sdate.c_str()));
+        if (!_check_simd) return;
+
+        // Run the scalar accumulators alongside and compare.
+        for (int lane = 0; lane < W; ++lane)
+        {
+            size_t isymbol = size_t(ibatch) * W + lane;
+            if (_symbol.size() <= isymbol) break;
+
+            _adc[isymbol].update(dc[lane], _cdc[isymbol]);
+            _adac[isymbol].update(dac[lane], _cdac[isymbol]);
+            _adcb[isymbol].update(dcb[lane], _cdcb[isymbol]);
+            _adacb[isymbol].update(dacb[lane], _cdacb[isymbol]);
+
+            if (!same_statistics(_mdc[isymbol], _cdc[isymbol])     ||
+                !same_statistics(_mdac[isymbol], _cdac[isymbol])   ||
+                !same_statistics(_mdcb[isymbol], _cdcb[isymbol])   ||
+                !same_statistics(_mdacb[isymbol], _cdacb[isymbol]) )
+                ++_simd_mismatches;
+        }
+    }
+
+    //  assign_global_ids
+    //      Look up the global id of every symbol in lists/SymbolIds.txt,
+    //      adding the ones it hasn't seen to the end, so a symbol keeps
+    //      its id from run to run as the lists change.
+    //
+    void assign_global_ids()
+    {
+        SymbolTable ids;
+        load_symbols_from(ids, constants::lists_dir, constants::symbol_ids);
+        size_t known = ids.size();
 
-        string means_dir(constants::means_path(sdate.c_str()));
-        boost::filesystem::create_directory(means_dir);
-        means_dir += '/';
+        _global_id.resize(_symbol.size());
+        for (size_t i = 0; i < _symbol.size(); ++i)
+            _global_id[i] = ids.intern(_symbol[i].Symbol);
 
-        ofstream of_mdc(
-            string(means_dir + constants::deltaclose).c_str(),
-            ios_base::binary);
+        if (ids.size() != known)
+            save_symbols_to(ids, constants::lists_dir, constants::symbol_ids);
+        _global_ids = uint32_t(ids.size());
+    }
+
+    //  write_out_data
+    //      Write out the current statistical data.
+    //
+    void write_out_data(int date)
+    {
+        write_out_data(date, _mdc, _mdac, _mdcb, _mdacb);
+
+        if (_use_bank)
+            write_out_bank(date, _mdc, _wmdc, _wmdac, _wmdcb, _wmdacb);
+
+        if (_use_ewma)
+            write_out_ewma(date, _emdc, _emdac, _emdcb, _emdacb);
+    }
+
+    //  is_written
+    //      Return true if a symbol's data gets written out for a day.
+    //      Decides the rows of lists/<date> and every means file.
+    //
+    static bool is_written(const FloatStatisticalData& sd)
+    {
+        return (FloatType::is_valid(sd.value)         &&
+                FloatType::is_valid(sd.fifty_day.mean));
+    }
+
+    //  window_valid
+    //      The days of a symbol's windows it really traded on, as
+    //      written to the validity file (see WindowValidity).
+    //      window - trading day of each day in the 50-day window,
+    //               oldest first.
+    //
+    inline uint64_t window_valid(int isymbol, const vector<int>& window)
+    {
+        uint64_t valid = 0;
+        for (size_t i = 0; i < window.size(); ++i)
+            valid |= uint64_t(_change[isymbol].is_valid(window[i])) << i;
+        return valid;
+    }
 
-        ofstream of_mdac(
-            string(means_dir + constants::deltaadjclose).c_str(),
-            ios_base::binary);
+    //  write_out_data
+    //      Write out the data. Builds five files, one record at a time,
+    //      and the validity of each row's windows.
+    //
+    void write_out_data(int                          date,
+                        const FloatStatisticalDeque& mdc,
+                        const FloatStatisticalDeque& mdac,
+                        const FloatStatisticalDeque& mdcb,
+                        const FloatStatisticalDeque& mdacb)
+    {
+        // make sure there's something to write...
+        int got_data_count = 0;
+        for (size_t i = 0; i < _symbol.size(); ++i)
+        {
+            if (is_written(mdc[i]))
+                ++got_data_count;
+        }
+        if (1 >= got_data_count) return; // need at least two to correlate.
+
+        string sdate(boost::lexical_cast< string >(date));
+        OutFile of_symbols(constants::lists_dir, sdate);
+
+        constants::means_dir.make_directory(sdate);
+        Directory means_dir(constants::means_dir, sdate);
 
-        ofstream of_mdcb(
-            string(means_dir + constants::deltaclosenobkg).c_str(),
-            ios_base::binary);
+        OutFile of_mdc(means_dir, constants::deltaclose, ios_base::binary);
+        OutFile of_mdac(means_dir, constants::deltaadjclose, ios_base::binary);
+        OutFile of_mdcb(means_dir, constants::deltaclosenobkg, ios_base::binary);
+        OutFile of_mdacb(means_dir, constants::deltaadjclosenobkg,
+                         ios_base::binary);
+
+        if (constants::save_as_binary)
+        {
+            FileHeader header(FileHeader::describe< FloatStatisticalData >(
+                got_data_count, got_data_count, date));
+            header.save(of_mdc);
+            header.save(of_mdac);
+            header.save(of_mdcb);
+            header.save(of_mdacb);
+        }
 
-        ofstream of_mdacb(
-            string(means_dir + constants::deltaadjclosenobkg).c_str(),
-            ios_base::binary);
+        // Every symbol was fed every one of the last (up to 50) days.
+        vector<int> window;
+        BOOST_FOREACH(int d, _dates) window.push_back(_calendar.day(d));
 
-        for (int i = 0; i < _symbol.size(); ++i)
+        vector<SymbolId> ids;
+        vector<uint64_t> valid;
+        ids.reserve(got_data_count);
+        valid.reserve(got_data_count);
+        for (size_t i = 0; i < _symbol.size(); ++i)
         {
-            if (FloatType::is_valid(_mdc[i].value)         &&
-                FloatType::is_valid(_mdc[i].fifty_day.mean))
+            if (is_written(mdc[i]))
             {
                 of_symbols << _symbol[i].Symbol << endl;
-                of_mdc     << _mdc[i];
-                of_mdac    << _mdac[i];
-                of_mdcb    << _mdcb[i];
-                of_mdacb   << _mdacb[i];
+                of_mdc     << mdc[i];
+                of_mdac    << mdac[i];
+                of_mdcb    << mdcb[i];
+                of_mdacb   << mdacb[i];
+                ids.push_back(_global_id[i]);
+                valid.push_back(window_valid(i, window));
             }
         }
+
+        DayRows rows;
+        rows.assign(_global_ids, ids, date);
+        rows.save(constants::lists_dir, sdate + constants::day_rows_suffix);
+
+        WindowValidity validity;
+        validity.assign(valid, date);
+        validity.save(means_dir, constants::window_validity);
         
-        ofstream of_dates(string(means_dir + "dates").c_str());
+        OutFile of_dates(means_dir, "dates");
         of_dates << "Directory represents data from "
                  << DateIndex::to_string(_dates.front())
                  << " to "
@@ -218,56 +1139,330 @@ protected:
                  << endl;
     }
 
+    //  write_out_ewma
+    //      Write out the EWMA data. Unlike the other files these hold
+    //      every symbol, in SymbolDescriptors order, on every day with
+    //      data (even before the 50-day data starts), so correlate can
+    //      carry each pair's covariance from one day to the next.
+    //      Each file starts with the half-lives, then the FileHeader.
+    //      The rows' global ids go next to them (constants::ewma_rows),
+    //      so correlate can tell when the symbols change under it.
+    //
+    void write_out_ewma(int                              date,
+                        const FloatEwmaStatisticalDeque& emdc,
+                        const FloatEwmaStatisticalDeque& emdac,
+                        const FloatEwmaStatisticalDeque& emdcb,
+                        const FloatEwmaStatisticalDeque& emdacb)
+    {
+        string sdate(boost::lexical_cast< string >(date));
+        constants::means_dir.make_directory(sdate);
+        Directory means_dir(constants::means_dir, sdate);
+        const string& prefix = constants::ewma_prefix;
+
+        OutFile of_emdc(means_dir, prefix + constants::deltaclose,
+                        ios_base::binary);
+        OutFile of_emdac(means_dir, prefix + constants::deltaadjclose,
+                         ios_base::binary);
+        OutFile of_emdcb(means_dir, prefix + constants::deltaclosenobkg,
+                         ios_base::binary);
+        OutFile of_emdacb(means_dir, prefix + constants::deltaadjclosenobkg,
+                          ios_base::binary);
+
+        EwmaHalfLives::save_header(of_emdc);
+        EwmaHalfLives::save_header(of_emdac);
+        EwmaHalfLives::save_header(of_emdcb);
+        EwmaHalfLives::save_header(of_emdacb);
+
+        if (constants::save_as_binary)
+        {
+            FileHeader header(FileHeader::describe< FloatEwmaStatisticalData >(
+                _symbol.size(), _symbol.size(), date));
+            header.save(of_emdc);
+            header.save(of_emdac);
+            header.save(of_emdcb);
+            header.save(of_emdacb);
+        }
+
+        for (size_t i = 0; i < _symbol.size(); ++i)
+        {
+            of_emdc   << emdc[i];
+            of_emdac  << emdac[i];
+            of_emdcb  << emdcb[i];
+            of_emdacb << emdacb[i];
+        }
+
+        DayRows rows;
+        rows.assign(_global_ids, _global_id, date);
+        rows.save(means_dir, constants::ewma_rows);
+    }
+
+    //  write_out_bank
+    //      Write out the window bank data for the same rows as
+    //      write_out_data. Four files, each starting with the
+    //      list of window lengths, then the FileHeader.
+    //      mdc - decides which symbols are written.
+    //
+    void write_out_bank(int                                date,
+                        const FloatStatisticalDeque&       mdc,
+                        const FloatBankedStatisticalDeque& wmdc,
+                        const FloatBankedStatisticalDeque& wmdac,
+                        const FloatBankedStatisticalDeque& wmdcb,
+                        const FloatBankedStatisticalDeque& wmdacb)
+    {
+        string sdate(boost::lexical_cast< string >(date));
+
+        // write_out_data didn't think it was worth it.
+        if (!constants::means_dir.exists(sdate)) return;
+        Directory means_dir(constants::means_dir, sdate);
+        const string& prefix = constants::window_bank_prefix;
+
+        OutFile of_wmdc(means_dir, prefix + constants::deltaclose,
+                        ios_base::binary);
+        OutFile of_wmdac(means_dir, prefix + constants::deltaadjclose,
+                         ios_base::binary);
+        OutFile of_wmdcb(means_dir, prefix + constants::deltaclosenobkg,
+                         ios_base::binary);
+        OutFile of_wmdacb(means_dir, prefix + constants::deltaadjclosenobkg,
+                          ios_base::binary);
+
+        save_window_header<FloatWindowBank::Lengths>(of_wmdc);
+        save_window_header<FloatWindowBank::Lengths>(of_wmdac);
+        save_window_header<FloatWindowBank::Lengths>(of_wmdcb);
+        save_window_header<FloatWindowBank::Lengths>(of_wmdacb);
+
+        if (constants::save_as_binary)
+        {
+            int rows = 0;
+            for (size_t i = 0; i < _symbol.size(); ++i)
+            {
+                if (is_written(mdc[i]))
+                    ++rows;
+            }
+
+            FileHeader header(FileHeader::describe< FloatBankedStatisticalData >(
+                rows, rows, date));
+            header.save(of_wmdc);
+            header.save(of_wmdac);
+            header.save(of_wmdcb);
+            header.save(of_wmdacb);
+        }
+
+        for (size_t i = 0; i < _symbol.size(); ++i)
+        {
+            if (is_written(mdc[i]))
+            {
+                of_wmdc   << wmdc[i];
+                of_wmdac  << wmdac[i];
+                of_wmdcb  << wmdcb[i];
+                of_wmdacb << wmdacb[i];
+            }
+        }
+    }
+
     //  _progress_bar
     //      Give the user a little feedback...
     //
-    static ProgressBar           _progress_bar;
+    ProgressBar           _progress_bar;
 
     //  _symbol
     //      The master list of symbol descriptors.
     //
-    static SymbolDescriptorDeque _symbol;
+    SymbolDescriptorDeque _symbol;
+
+    //  _global_id
+    //  _global_ids
+    //      Global id of each symbol (see DayRows), and how many
+    //      there are.
+    //
+    vector<SymbolId>      _global_id;
+    uint32_t              _global_ids;
 
     //  _ticker
-    //      All of the historical data for the symbols, date indexed.
+    //      All of the historical data for the symbols, by trading day.
     //
-    static TickerSignalDeque     _ticker;
+    TickerSignalDeque     _ticker;
+
+    //  _calendar
+    //      The days any symbol traded. Every signal here is indexed
+    //      by trading day, the files and _dates by date index.
+    //
+    TradingCalendar       _calendar;
+
+    //  _use_store
+    //      Load the ticks from the tick store when there is one.
+    //
+    bool                  _use_store;
+
+    //  _load_threads
+    //  _next_load
+    //  _bytes_loaded
+    //      Ticker file loading: threads to use, the next symbol to
+    //      load and the bytes read so far.
+    //
+    int                   _load_threads;
+    boost::atomic<int>    _next_load;
+    boost::atomic<uint64_t> _bytes_loaded;
     
-    static list<int>             _dates;
+    list<int>             _dates;
+
+    //  _first_date
+    //      First date to process. Later than the first date
+    //      when appending to a checkpoint.
+    //
+    int                   _first_date;
+
+    //  _last_date
+    //      Date to stop before. The end date unless told to stop
+    //      early (see stop_before).
+    //
+    int                   _last_date;
+
+    //  _first_day
+    //  _last_day
+    //      _first_date and _last_date as trading days, once the
+    //      calendar is built and any checkpoint loaded.
+    //
+    int                   _first_day;
+    int                   _last_day;
     
     //  _m*
     //      Statistical data for each of the symbols.
     //
-    static FloatStatisticalDeque _mdc;
-    static FloatStatisticalDeque _mdac;
-    static FloatStatisticalDeque _mdcb;
-    static FloatStatisticalDeque _mdacb;
+    FloatStatisticalDeque _mdc;
+    FloatStatisticalDeque _mdac;
+    FloatStatisticalDeque _mdcb;
+    FloatStatisticalDeque _mdacb;
     
     //  _a*
     //      Moving averages for each of the symbols.
     //
-    static FloatAccumulatorDeque _adc;
-    static FloatAccumulatorDeque _adac;
-    static FloatAccumulatorDeque _adcb;
-    static FloatAccumulatorDeque _adacb;
+    FloatAccumulatorDeque _adc;
+    FloatAccumulatorDeque _adac;
+    FloatAccumulatorDeque _adcb;
+    FloatAccumulatorDeque _adacb;
+
+    //  _wm*
+    //  _wa*
+    //      Window bank statistical data and moving averages.
+    //
+    bool                        _use_bank;
+    FloatBankedStatisticalDeque _wmdc;
+    FloatBankedStatisticalDeque _wmdac;
+    FloatBankedStatisticalDeque _wmdcb;
+    FloatBankedStatisticalDeque _wmdacb;
+    FloatBankedAccumulatorDeque _wadc;
+    FloatBankedAccumulatorDeque _wadac;
+    FloatBankedAccumulatorDeque _wadcb;
+    FloatBankedAccumulatorDeque _wadacb;
+
+    //  _em*
+    //  _ea*
+    //      EWMA statistical data and accumulators.
+    //
+    bool                      _use_ewma;
+    FloatEwmaStatisticalDeque _emdc;
+    FloatEwmaStatisticalDeque _emdac;
+    FloatEwmaStatisticalDeque _emdcb;
+    FloatEwmaStatisticalDeque _emdacb;
+    FloatEwmaAccumulatorDeque _eadc;
+    FloatEwmaAccumulatorDeque _eadac;
+    FloatEwmaAccumulatorDeque _eadcb;
+    FloatEwmaAccumulatorDeque _eadacb;
+
+    //  _s*
+    //      Batched moving averages, FloatLanes::width symbols each.
+    //
+    bool                    _use_simd;
+    BatchedAccumulatorDeque _sdc;
+    BatchedAccumulatorDeque _sdac;
+    BatchedAccumulatorDeque _sdcb;
+    BatchedAccumulatorDeque _sdacb;
+
+    //  _c*
+    //      Scalar results used to check the batched accumulators.
+    //
+    bool                    _check_simd;
+    boost::atomic<int>      _simd_mismatches;
+    FloatStatisticalDeque   _cdc;
+    FloatStatisticalDeque   _cdac;
+    FloatStatisticalDeque   _cdcb;
+    FloatStatisticalDeque   _cdacb;
     
-    //  _b*
-    //      Backgrounds.
+    //  _change
+    //      Each symbol's change of close by trading day; see
+    //      compute_changes.
+    //
+    vector<MaskedSignal> _change;
+
+    //  _bkg
+    //  _bdc
+    //      getdata's background, the mean previous / current close of
+    //      each date, and the mean change it makes.
+    //
+    FloatSignal _bkg;
+    FloatSignal _bdc;
+
+    //  DayBuffer
+    //      One day of statistical data waiting to be written out
+    //      by the symbol-major engine.
+    //
+    struct DayBuffer
+    {
+        FloatStatisticalDeque mdc;
+        FloatStatisticalDeque mdac;
+        FloatStatisticalDeque mdcb;
+        FloatStatisticalDeque mdacb;
+
+        FloatBankedStatisticalDeque wmdc;
+        FloatBankedStatisticalDeque wmdac;
+        FloatBankedStatisticalDeque wmdcb;
+        FloatBankedStatisticalDeque wmdacb;
+
+        FloatEwmaStatisticalDeque emdc;
+        FloatEwmaStatisticalDeque emdac;
+        FloatEwmaStatisticalDeque emdcb;
+        FloatEwmaStatisticalDeque emdacb;
+
+        //  ranges_done
+        //      Number of symbol ranges that have filled this day.
+        //
+        int ranges_done;
+    };
+
+    //  s_day_buffer_depth
+    //      How far the fastest range may run ahead of the writer.
+    //
+    static const int s_day_buffer_depth = 8;
+
+    //  _days
+    //      The trading days with data, in order.
+    //
+    vector<int>          _days;
+
+    //  _day_buffer
+    //      Ring of per-day output buffers. _days[k] lives in
+    //      _day_buffer[k % s_day_buffer_depth].
+    //
+    DayBuffer            _day_buffer[s_day_buffer_depth];
+
+    //  _days_flushed
+    //      Count of _days written out so far.
     //
-    static FloatSignal _bdc;
-    static FloatSignal _bdac;
+    int                  _days_flushed;
 
-    //  EngineSemaphore
-    //      Loop through all of the symbols using an index.
+    //  _day_mutex
+    //  _day_condition
+    //      Guard the day buffer bookkeeping between the ranges
+    //      and the writer.
     //
-    class AccumulationCylinder;
+    boost::mutex         _day_mutex;
+    boost::condition_variable _day_condition;
 
-    typedef Semaphore< DoNothing,
-                       AccumulationCylinder,
-                       DoNothing > EngineSemaphore;
-    friend class Semaphore< DoNothing,
-                            AccumulationCylinder,
-                            DoNothing >;
+    //  _next_unit
+    //      Next unit of work (symbol or batch) for the
+    //      AccumulationCylinders of the current date.
+    //
+    boost::atomic<int>   _next_unit;
 
     //  AccumulationCylinder
     //      Process a chunk of data.
@@ -276,96 +1471,131 @@ protected:
     {
     public:
         //  Constructor
+        //      engine - the engine to work for.
+        //      day    - current trading day.
         //
-        AccumulationCylinder(int date) : _isymbol(0), _idate(date) { }
+        AccumulationCylinder(AccumulationEngine& engine, int day) :
+            _engine(engine), _iday(day) { }
 
         //  operator()()
         //      Thread Main. While there's something to update,
-        //      Increment the count and update the one you got.
+        //      take the next unit of work and update it.
         //
         void operator()()
         {
-            bool done = false;
-            while(!done)
+            for (int unit = _engine._next_unit++;
+                 _engine.unit_count() > unit;
+                 unit = _engine._next_unit++)
             {
-                EngineSemaphore::increment(*this);
+                _engine.accumulate_unit(unit, _iday);
+            }
+        }
 
-                if(AccumulationEngine::_symbol.size() > _isymbol)
+    protected:
+        //  _engine
+        //      The engine being worked for.
+        //
+        AccumulationEngine& _engine;
+        
+        //  _iday
+        //      Current trading day.
+        //
+        int _iday;
+    };
+    friend class AccumulationCylinder;
+
+    //  SymbolRangeCylinder
+    //      Stream a range of symbols through all of the dates.
+    //
+    class SymbolRangeCylinder
+    {
+    public:
+        //  Constructor
+        //      engine     - the engine to work for.
+        //      begin, end - Half open range of units of work
+        //                   (symbols or batches of symbols).
+        //
+        SymbolRangeCylinder(AccumulationEngine& engine, int begin, int end) :
+            _engine(engine), _begin(begin), _end(end) { }
+
+        //  operator()()
+        //      Thread Main. For each day with data, wait for room in the
+        //      day buffer, update the range and copy the results out.
+        //
+        void operator()()
+        {
+            AccumulationEngine& e = _engine;
+
+            for (size_t k = 0; k < e._days.size(); ++k)
+            {
                 {
-                    // Not all symbols trade every day, but only here
-                    // if some symbols traded on this day.
-if(FloatType::is_invalid(
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].Close))
-{
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].DeltaClose = 0.0;
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].DeltaAdjClose = 0.0;
-}
+                    boost::unique_lock<boost::mutex> lock(e._day_mutex);
+                    while (size_t(e._days_flushed) + e.s_day_buffer_depth <= k)
+                        e._day_condition.wait(lock);
+                }
 
-AccumulationEngine::_adc[_isymbol].update(
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].DeltaClose,
-    AccumulationEngine::_mdc[_isymbol]);
+                int iday = e._days[k];
+                DayBuffer& day = e._day_buffer[k % e.s_day_buffer_depth];
+
+                for (int u = _begin; u < _end; ++u)
+                {
+                    e.accumulate_unit(u, iday);
 
-AccumulationEngine::_adac[_isymbol].update(
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].DeltaAdjClose,
-    AccumulationEngine::_mdac[_isymbol]);
+                    for (int i = e.unit_begin(u); i < e.unit_end(u); ++i)
+                    {
+                        day.mdc[i]   = e._mdc[i];
+                        day.mdac[i]  = e._mdac[i];
+                        day.mdcb[i]  = e._mdcb[i];
+                        day.mdacb[i] = e._mdacb[i];
 
-AccumulationEngine::_adcb[_isymbol].update(
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].DeltaClose - 
-        AccumulationEngine::_bdc.sample[_idate],
-    AccumulationEngine::_mdcb[_isymbol]);
+                        if (e._use_bank)
+                        {
+                            day.wmdc[i]   = e._wmdc[i];
+                            day.wmdac[i]  = e._wmdac[i];
+                            day.wmdcb[i]  = e._wmdcb[i];
+                            day.wmdacb[i] = e._wmdacb[i];
+                        }
 
-AccumulationEngine::_adacb[_isymbol].update(
-    AccumulationEngine::_ticker[_isymbol].sample[_idate].DeltaAdjClose - 
-        AccumulationEngine::_bdac.sample[_idate],
-    AccumulationEngine::_mdacb[_isymbol]);
+                        if (e._use_ewma)
+                        {
+                            day.emdc[i]   = e._emdc[i];
+                            day.emdac[i]  = e._emdac[i];
+                            day.emdcb[i]  = e._emdcb[i];
+                            day.emdacb[i] = e._emdacb[i];
+                        }
+                    }
                 }
-                else
-                    done = true;
 
-                boost::this_thread::yield();
+                {
+                    boost::lock_guard<boost::mutex> lock(e._day_mutex);
+                    ++day.ranges_done;
+                }
+                e._day_condition.notify_all();
             }
         }
 
     protected:
-        friend class Semaphore< DoNothing,
-                                AccumulationCylinder,
-                                DoNothing >;
-
-        //  operator()(int)
-        //      Pick an accumulator to update.
+        //  _engine
+        //      The engine being worked for.
         //
-        void operator()(int i)
-        {
-            _isymbol = i;
-        }
-        
-        //  _isymbol
-        //      Symbol index.
-        //
-        int _isymbol;
-        
-        //  _idate
-        //      Current date index.
+        AccumulationEngine& _engine;
+
+        //  _begin, _end
+        //      Range of units of work owned by this worker.
         //
-        int _idate;
+        int _begin;
+        int _end;
     };
-    friend class AccumulationCylinder;
+    friend class SymbolRangeCylinder;
+
+private:
+    //  Do Not Copy
+    //
+    AccumulationEngine(const AccumulationEngine&);
+    AccumulationEngine& operator=(const AccumulationEngine&);
 };
 
-ProgressBar           AccumulationEngine::_progress_bar;
-SymbolDescriptorDeque AccumulationEngine::_symbol;
-TickerSignalDeque     AccumulationEngine::_ticker;
-list<int>             AccumulationEngine::_dates;
-FloatStatisticalDeque AccumulationEngine::_mdc;
-FloatStatisticalDeque AccumulationEngine::_mdac;
-FloatStatisticalDeque AccumulationEngine::_mdcb;
-FloatStatisticalDeque AccumulationEngine::_mdacb;
-FloatAccumulatorDeque AccumulationEngine::_adc;
-FloatAccumulatorDeque AccumulationEngine::_adac;
-FloatAccumulatorDeque AccumulationEngine::_adcb;
-FloatAccumulatorDeque AccumulationEngine::_adacb;
-FloatSignal           AccumulationEngine::_bdc;
-FloatSignal           AccumulationEngine::_bdac;
+
 
 
 
@@ -375,12 +1605,100 @@ FloatSignal           AccumulationEngine::_bdac;
 //
 int main(int argc, char * argv[])
 {
+    // Command line processing.
+    //
+    string half_lives;
+    string stop_before;
+    int    load_threads;
+
+    po::options_description desc("Allowed options");
+    desc.add_options()
+        ("help", "preprocess - Pre-compute the moving averages for correlate.")
+        ("symbol-major",
+         "Stream ranges of symbols through all dates instead of "
+         "spinning up a thread group per date.")
+        ("simd",
+         "Update the moving averages of several symbols per step "
+         "with the batched (AVX2/AVX-512) accumulators.")
+        ("window-bank",
+         "Also compute every window length in the window bank "
+         "(see window_bank.h) and write them to the bank.* files.")
+        ("ewma",
+         "Also compute exponentially weighted moving averages "
+         "and write them to the ewma.* files.")
+        ("half-lives", po::value< string >(&half_lives)->default_value("10,50"),
+         "EWMA half-lives in trading days, at most four, eg. 5,20,60.")
+        ("append",
+         "Load the checkpoint left by the last run and only process "
+         "the dates after it.")
+        ("simd-check",
+         "Like --simd, but also run the scalar accumulators and "
+         "report any symbol-days where the results differ.")
+        ("stop-before", po::value< string >(&stop_before),
+         "Only process the dates before this one (eg. 2011-12-01), "
+         "leaving the checkpoint there for a later --append.")
+        ("tick-files",
+         "Load the per-symbol ticker files even if getdata wrote "
+         "a tick store.")
+        ("load-threads", po::value< int >(&load_threads)->default_value(4),
+         "Number of ticker files to read at once.")
+    ;
+
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+
+    if (vm.count("help"))
+    {
+        cout << desc << endl;
+        return 0;
+    }
+
+    AccumulationEngine engine;
+
+    if (vm.count("window-bank"))
+        engine.use_window_bank();
+
+    if (vm.count("ewma"))
+    {
+        if (!EwmaHalfLives::parse(half_lives))
+        {
+            cout << "Bad --half-lives: " << half_lives << endl;
+            return 1;
+        }
+        engine.use_ewma();
+    }
+
+    if (vm.count("simd") || vm.count("simd-check"))
+        engine.use_simd(0 != vm.count("simd-check"));
+
+    if (vm.count("stop-before") &&
+        !engine.stop_before(DateIndex::from_string(stop_before)))
+    {
+        cout << "Bad --stop-before: " << stop_before << endl;
+        return 1;
+    }
+
+    if (vm.count("tick-files"))
+        engine.use_tick_files();
+
+    if (1 > load_threads)
+    {
+        cout << "Bad --load-threads: " << load_threads << endl;
+        return 1;
+    }
+    engine.use_load_threads(load_threads);
+
     // Pre-compute a pile of statistics around the historical
     // stock data.
     
     // Load symbol descriptor set and all of the ticks.
     //
-    if (!AccumulationEngine::load_data()) return 0;
+    if (!engine.load_data()) return 0;
+
+    // Pick up where the last run left off.
+    //
+    if (vm.count("append") && !engine.load_checkpoint()) return 1;
     
     // For each day: update 4*_all_symbols.size() accumulators.
     //               If there's valid data for that day and symbol,
@@ -389,10 +1707,27 @@ int main(int argc, char * argv[])
     //                  Write out list and current set of 
     //                  Statistical data from each accumulator.
     //
-    AccumulationEngine::initialize_engine();
-    while(!AccumulationEngine::done())
-        AccumulationEngine::process_a_date();
+    if (vm.count("symbol-major"))
+    {
+        engine.process_by_symbol_range();
+    }
+    else
+    {
+        engine.initialize_engine();
+        while(!engine.done())
+            engine.process_a_date();
+    }
+
+    // Leave a checkpoint for the next --append.
+    //
+    if (!engine.save_checkpoint())
+        ::puts("\nFailed to write the checkpoint!");
+
+    if (vm.count("simd-check"))
+    {
+        ::printf("\nBatched accumulators differed from scalar on %i symbol-days.\n",
+                 engine.simd_mismatches());
+    }
     
     return 0;
 }
-
@@ -2,6 +2,7 @@
 #include "../include/date_index.h"
 #include "../include/constants.h"
 #include "../include/tickers.h"
+#include "../include/tick_store.h"
 #include "../include/symbols.h"
 #include "../include/source_data.h"
 #include "../include/numerictypes.h"
@@ -19,7 +20,7 @@ class Backgrounder
 public:
     static void load_bkg()
     {
-        bkg.load_from("background.dat");
+        bkg.load_from(constants::data_dir, "background.dat");
     }
 
     //  operator()
@@ -31,36 +32,44 @@ public:
     {
         static TickerSet ticks;
         ticks.clear();
-        load_from(ticks, sd.DATFile.c_str());
+        load_from(ticks, constants::data_dir, sd.DATFile);
 
         BOOST_FOREACH(Ticker& t, ticks)
         {
             t.value.apply_inv_delta(bkg.sample[t.index]);
         }
 
-        save_to(ticks, sd.DATFile.c_str());
+        save_to(ticks, constants::data_dir, sd.DATFile);
+        store.add(sd.Symbol, ticks);
+    }
+
+    //  record_store
+    //      Rewrite the tick store to match the ticker files.
+    //      symbols - the list of symbols.
+    //
+    static bool record_store(const SymbolDescriptorSet& symbols)
+    {
+        return store.save(symbols, constants::data_dir, constants::tick_store);
     }
 
 protected:
     static FloatSignal bkg;
+    static TickStoreWriter store;
 
 };
 FloatSignal Backgrounder::bkg;
+TickStoreWriter Backgrounder::store;
 
 
 int main (int argc, char * argv[])
 {
-    // Change directories into the lists directory.
-    ::puts(constants::lists_path.base_path());
-    WorkingDirectory current_dir(constants::lists_path.base_path());
-
     // Load up the list of symbols.
+    ::puts(constants::lists_path.base_path());
     SymbolDescriptorSet the_tickers;
-    load_from(the_tickers, "SymbolDescriptors.txt");
+    load_from(the_tickers, constants::lists_dir, "SymbolDescriptors.txt");
 
-    // Change directories into the data directory.
+    // The ticks are in the data directory.
     ::puts(constants::data_path.base_path());
-    current_dir.chdir(constants::data_path.base_path());
 
     ::puts("Loading background...");
     Backgrounder::load_bkg();
@@ -68,5 +77,8 @@ int main (int argc, char * argv[])
     Backgrounder remove_background;
     the_tickers.foreach(remove_background);
 
+    ::puts("Writing tick store...");
+    Backgrounder::record_store(the_tickers);
+
     return 0;
 }
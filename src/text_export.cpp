@@ -9,6 +9,8 @@
 #include "../include/tickers.h"
 #include "../include/signals.h"
 #include "../include/correlations.h"
+#include "../include/day_rows.h"
+#include "../include/window_validity.h"
 
 namespace po = boost::program_options;
 using namespace std;
@@ -35,7 +37,9 @@ int main(int ac, char * av[])
         "   f = found correlations\n"
         "   m = date index map\n"
         "   p = preprocessed data\n" 
-        "   t = ticks")
+        "   r = rows of a day by global symbol id\n"
+        "   t = ticks\n"
+        "   v = window validity of a day's means")
         ("input-files", po::value< vector<string> >(&input_files), 
           "Files to export. eg. text_export kind=t A.dat B.dat")
     ;
@@ -143,6 +147,50 @@ int main(int ac, char * av[])
                     }
                     break;
 
+                case 'R':
+                case 'r':           // day rows
+                    cout << " as the rows of a day..." << endl;
+                    {
+                        DayRows rows;
+                        if (!rows.load(filename.c_str()))
+                        {
+                            cout << filename << " failed to load! Skipping..." << endl;
+                            break;
+                        }
+
+                        ofstream out(outfilename.c_str());
+                        out << "date " << rows.date()
+                            << ", rows " << rows.size()
+                            << ", global ids " << rows.symbols() << endl;
+                        for (int r = 0; r < int(rows.size()); ++r)
+                            out << r << " " << rows.id(r) << endl;
+                    }
+                    break;
+
+                case 'V':
+                case 'v':           // window validity
+                    cout << " as the window validity of a day..." << endl;
+                    {
+                        WindowValidity validity;
+                        if (!validity.load(filename.c_str()))
+                        {
+                            cout << filename << " failed to load! Skipping..." << endl;
+                            break;
+                        }
+
+                        ofstream out(outfilename.c_str());
+                        out << "date " << validity.date()
+                            << ", rows " << validity.size() << endl;
+                        for (int r = 0; r < int(validity.size()); ++r)
+                        {
+                            out << r << " ";
+                            for (int i = 0; i < WindowValidity::days; ++i)
+                                out << ((validity[r] >> i) & 1);
+                            out << endl;
+                        }
+                    }
+                    break;
+
                 case 'T':
                 case 't':           // ticks
                     cout << " as a set of ticks..." << endl;